@@ -0,0 +1,107 @@
+/*
+* Author: Peter Hess
+* File: Arena.c
+*
+* Bump allocator. Blocks are chained through a header at their start, and
+* allocations are rounded up to ARENA_ALIGN so each one is suitably aligned.
+*/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "Arena.h"
+
+#define ARENA_ALIGN 16
+
+typedef struct ArenaBlock {
+	struct ArenaBlock* prev;		//Block allocated before this one, or NULL
+	max_align_t align;				//Puts the memory after the header on an ARENA_ALIGN boundary
+}ArenaBlock;
+
+struct Arena {
+	size_t blockSize;
+	ArenaBlock* blocks;				//Most recently allocated block
+	char* next;						//Free memory left in the current block
+	char* end;
+	size_t size;					//Bytes handed out
+};
+
+/**
+* Allocate and return a new, empty Arena that takes memory from the system
+* blockSize bytes at a time (ARENA_BLOCK_SIZE if blockSize is 0).
+*/
+Arena* Arena_new(size_t blockSize) {
+	Arena* arena = (Arena*)malloc(sizeof(Arena));
+	(arena->blockSize) = (blockSize > 0) ? blockSize : ARENA_BLOCK_SIZE;
+	(arena->blocks) = NULL;
+	(arena->next) = NULL;
+	(arena->end) = NULL;
+	(arena->size) = 0;
+	return arena;
+}
+
+/**
+* Free the given Arena and everything ever allocated from it.
+*/
+void Arena_free(Arena* arena) {
+	ArenaBlock* block = (arena->blocks);
+	while (block != NULL) {
+		ArenaBlock* prev = (block->prev);
+		free(block);
+		block = prev;
+	}
+	free(arena);
+}
+
+//Allocate a block with room for n bytes and link it in; the current block stays current unless replace
+static char* Arena_new_block(Arena* arena, size_t n, bool replace) {
+	ArenaBlock* block = (ArenaBlock*)malloc(offsetof(ArenaBlock, align) + n);
+	char* memory = (char*)block + offsetof(ArenaBlock, align);
+	if (replace || (arena->blocks) == NULL) {
+		(block->prev) = (arena->blocks);
+		(arena->blocks) = block;
+		(arena->next) = replace ? memory : memory + n;	//A dedicated block is full from the start
+		(arena->end) = memory + n;
+	}
+	else {										//Hide a dedicated block behind the current one
+		(block->prev) = (arena->blocks)->prev;
+		(arena->blocks)->prev = block;
+	}
+	return memory;
+}
+
+/**
+* Return n bytes of memory from the given Arena, aligned for any type.
+*/
+void* Arena_alloc(Arena* arena, size_t n) {
+	n = (n + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+	(arena->size) += n;
+	if (n > (size_t)((arena->end) - (arena->next))) {
+		if (n > (arena->blockSize) / 2) {		//Large: a block of its own
+			return Arena_new_block(arena, n, false);
+		}
+		Arena_new_block(arena, arena->blockSize, true);
+	}
+	void* p = (arena->next);
+	(arena->next) += n;
+	return p;
+}
+
+/**
+* Return memory from the given Arena for n objects of the given size, all
+* set to zero, like calloc.
+*/
+void* Arena_calloc(Arena* arena, size_t n, size_t size) {
+	void* p = Arena_alloc(arena, n * size);
+	memset(p, 0, n * size);
+	return p;
+}
+
+/**
+* Return the number of bytes the given Arena has handed out so far.
+*/
+size_t Arena_get_size(const Arena* arena) {
+	return (arena->size);
+}
@@ -0,0 +1,51 @@
+/*
+* Author: Peter Hess
+* File: Arena.h
+*
+* Bump allocator for memory that lives exactly as long as one automaton or
+* one construction run: allocations are carved one after another out of
+* large blocks and are never freed on their own, only all together.
+*/
+
+#ifndef _Arena_h
+#define _Arena_h
+
+#include <stddef.h>
+
+#define ARENA_BLOCK_SIZE (64 << 10)	//Default block size, for Arena_new(0)
+
+/**
+* Memory from an Arena. Allocations larger than half a block get a block of
+* their own, so a large request never wastes the rest of the current block.
+*/
+typedef struct Arena Arena;
+
+/**
+* Allocate and return a new, empty Arena that takes memory from the system
+* blockSize bytes at a time (ARENA_BLOCK_SIZE if blockSize is 0).
+*/
+extern Arena* Arena_new(size_t blockSize);
+
+/**
+* Free the given Arena and everything ever allocated from it.
+*/
+extern void Arena_free(Arena* arena);
+
+/**
+* Return n bytes of memory from the given Arena, aligned for any type. The
+* memory stays valid until the Arena is freed.
+*/
+extern void* Arena_alloc(Arena* arena, size_t n);
+
+/**
+* Return memory from the given Arena for n objects of the given size, all
+* set to zero, like calloc.
+*/
+extern void* Arena_calloc(Arena* arena, size_t n, size_t size);
+
+/**
+* Return the number of bytes the given Arena has handed out so far.
+*/
+extern size_t Arena_get_size(const Arena* arena);
+
+#endif
@@ -4,7 +4,6 @@
 * Date: 9/20/17
 *
 * Hardwires examples for the DFA and NFA data structure.
-* Implements the subset construction algorithm.
 * Gets user input to test DFA/NFA examples.
 */
 
@@ -14,23 +13,45 @@
 #include "dfa.h"
 #include "nfa.h"
 #include "IntSet.h"
-#include "LinkedList.h"
+#include "subset.h"
+#include "StaticDFA.h"
 #include "Auto.h"
 
 void getUserInputDFA(DFA* dfa);
 void getUserInputNFA(NFA* nfa);
-DFA* subsetConstruct(NFA* nfa);
+void getUserInputStaticDFA(const StaticDFA* dfa);
+
+//DFAs whose transitions are all spelled out are fixed at compile time as StaticDFAs;
+//those with a transition on every symbol are built at run time with DFA_set_transition_all
+static const uint8_t onlyABTable[3][256] = {
+	[0] = { ['a'] = STATIC_DFA_TO(1) },
+	[1] = { ['b'] = STATIC_DFA_TO(2) },
+	[2] = { 0 },
+};
+static const bool onlyABAccept[3] = { false, false, true };
+
+static const uint8_t evenOnesTable[2][256] = {
+	[0] = { ['0'] = STATIC_DFA_TO(0), ['1'] = STATIC_DFA_TO(1) },
+	[1] = { ['0'] = STATIC_DFA_TO(1), ['1'] = STATIC_DFA_TO(0) },
+};
+static const bool evenOnesAccept[2] = { true, false };
+
+static const uint8_t evenOnesZerosTable[4][256] = {
+	[0] = { ['0'] = STATIC_DFA_TO(2), ['1'] = STATIC_DFA_TO(1) },
+	[1] = { ['0'] = STATIC_DFA_TO(3), ['1'] = STATIC_DFA_TO(0) },
+	[2] = { ['0'] = STATIC_DFA_TO(0), ['1'] = STATIC_DFA_TO(3) },
+	[3] = { ['0'] = STATIC_DFA_TO(1), ['1'] = STATIC_DFA_TO(2) },
+};
+static const bool evenOnesZerosAccept[4] = { true, false, false, false };
 
 //DFA to accept the string "ab" (case-sensitive)
 void onlyAB() {
 	printf("This DFA accepts only the string \"ab\". (Case-sensitive)\n");
-	DFA* dfa = DFA_new(3);
-	DFA_set_transition(dfa, 0, 'a', 1);
-	DFA_set_transition(dfa, 1, 'b', 2);
-	DFA_set_accepting(dfa, 2, true);
+	static const StaticDFA sdfa = STATIC_DFA(onlyABTable, onlyABAccept);
+	DFA* dfa = StaticDFA_to_DFA(&sdfa);
 	DFA_print(dfa);
-	getUserInputDFA(dfa);
 	DFA_free(dfa);
+	getUserInputStaticDFA(&sdfa);
 	return;
 }
 
@@ -50,32 +71,16 @@ void startsWithAB() {
 //DFA accepts binary strings with an even number of ones (rejects if not a binary string)
 void evenOnes() {
 	printf("This DFA accepts only binary strings with an even number of 1s.\n");
-	DFA* dfa = DFA_new(2);
-	DFA_set_transition(dfa, 0, '0', 0);
-	DFA_set_transition(dfa, 0, '1', 1);
-	DFA_set_transition(dfa, 1, '1', 0);
-	DFA_set_transition(dfa, 1, '0', 1);
-	DFA_set_accepting(dfa, 0, true);
-	getUserInputDFA(dfa);
-	DFA_free(dfa);
+	static const StaticDFA sdfa = STATIC_DFA(evenOnesTable, evenOnesAccept);
+	getUserInputStaticDFA(&sdfa);
 	return;
 }
 
 //DFA accepts binary strings with an even number of ones and zeros (rejects if not a binary string)
 void evenOnesZeros() {
 	printf("This DFA accepts binary strings with an even number of 0s and 1s.\n");
-	DFA* dfa = DFA_new(4);
-	DFA_set_transition(dfa, 0, '0', 2);
-	DFA_set_transition(dfa, 0, '1', 1);
-	DFA_set_transition(dfa, 1, '1', 0);
-	DFA_set_transition(dfa, 1, '0', 3);
-	DFA_set_transition(dfa, 2, '0', 0);
-	DFA_set_transition(dfa, 2, '1', 3);
-	DFA_set_transition(dfa, 3, '1', 2);
-	DFA_set_transition(dfa, 3, '0', 1);
-	DFA_set_accepting(dfa, 0, true);
-	getUserInputDFA(dfa);
-	DFA_free(dfa);
+	static const StaticDFA sdfa = STATIC_DFA(evenOnesZerosTable, evenOnesZerosAccept);
+	getUserInputStaticDFA(&sdfa);
 	return;
 }
 
@@ -174,17 +179,16 @@ void getUserInputDFA(DFA* dfa) {
 		}
 		printf("Enter an input string: ");
 		scanf("%s", str);
-		dfa->curr = 0;
 	}
 }
 
 //Requests user input, executes input on given string
-void getUserInputNFA(NFA* nfa) {
+void getUserInputStaticDFA(const StaticDFA* dfa) {
 	char str[20];
 	printf("Enter an input string: ");
 	scanf("%s", str);
 	while (strcmp(str, "STOP") != 0) {
-		if (NFA_execute(nfa, str)) {
+		if (StaticDFA_execute(dfa, str)) {
 			printf("Accepted.\n");
 		}
 		else {
@@ -192,126 +196,24 @@ void getUserInputNFA(NFA* nfa) {
 		}
 		printf("Enter an input string: ");
 		scanf("%s", str);
-		IntSet* reset = IntSet_new();
-		IntSet_add(reset, 0);
-		nfa->curr = reset;
 	}
 }
 
-//DFA state: contains a set of states of the nfa, a label (int i), and a boolean (whether the state is accepting or not)
-typedef struct{
-	IntSet* val;
-	int i;
-	bool toAccept;
-}dfaState;
-
-//DFA transition: contains a current state with a transition to next on input
-typedef struct {
-	int curr;
-	char input;
-	int next;
-}dfaTrans;
-
-dfaState* dfaState_new(int n, IntSet* s, bool acc) {
-	dfaState* l = (dfaState*)malloc(sizeof(dfaState));
-	(l->i) = n;
-	(l->val) = s;
-	(l->toAccept) = acc;
-	return l;
-}
-
-dfaTrans* dfaTrans_new(int src, int dst, char sym) {
-	dfaTrans* l = (dfaTrans*)malloc(sizeof(dfaTrans));
-	(l->curr) = src;
-	(l->input) = sym;
-	(l->next) = dst;
-	return l;
-}
-
-/*
-* Function which takes an NFA as input and outputs an equivalent DFA, that is a DFA that accepts the same language.
-* Uses the subset construction algorithm. 
-*/
-DFA* subsetConstruct(NFA* nfa) {
-	IntSet* current = IntSet_new();			
-	IntSet_add(current, 0);
-	int numStates = 0;
-
-	LinkedList* states = LinkedList_new();	//List of DFA states (sets of states of the NFA)
-	LinkedList* trans = LinkedList_new();	//List of transitions between states.
-	LinkedList_add_at_end(states, dfaState_new(numStates++, current, (nfa->accept)[0])); //add {0} state
-
-	LinkedListIterator* iter1 = LinkedList_iterator(states);
-
-	int currIndex = 0;
-	while (currIndex < get_size(states)) {
-		dfaState* currLLState = ((dfaState*)LinkedList_element_at(states, currIndex));
-
-		for (int sym = 0; sym < sigma; sym++) {								//Iterate over alphabet
-
-			IntSet* dst = IntSet_new();										//Destination state
-			LinkedListIterator* iter2 = LinkedList_iterator(states);		//Need iterator to test whether 'dst' is already in states LL
-			IntSetIterator* currIter = IntSet_iterator(currLLState->val);	//Iterator for next dfaState in LL
-			bool dstAccept = false;											//True if dst contains an nfa accepting state (so state will be accepting in the dfa)
-
-			while (IntSetIterator_has_next(currIter)) {						
-				int temp = IntSetIterator_next(currIter);					//Iterate through nfa states in current set of states
-				IntSet_union(dst, &((nfa->tTable)[temp][sym]));				//Union together all possible states on a given symbol
-			}
-
-			if (IntSet_is_empty(dst) == false) {	//If dst isn't empty, then there are available transitions on sym; else nothing should be done
-				
-				bool isContained = false;						//Determine whether dst is already in states LL (using iter2)
-				int transDest;									//Name of destination state in dfa
-
-				while (LinkedListIterator_has_next(iter2)) { 
-
-					dfaState* tempState = (dfaState*)LinkedListIterator_next(iter2);
-					if (IntSet_equals(dst, tempState->val) == true) {		//tests if dst is in 
-						isContained = true;			
-						//printf("FLAG TRUE");
-						transDest = tempState->i;					//set transition destination to matched state
-						break;
-					}
-				}
-
-				if (isContained == false) {							//if dst is a new state, then add it to the states LL
-					IntSetIterator* i = IntSet_iterator(dst);
-					while (IntSetIterator_has_next(i)) {
-						int n = IntSetIterator_next(i);
-						if ((nfa->accept)[n]) {
-							dstAccept = true;
-						}
-					}
-					LinkedList_add_at_end(states, dfaState_new(numStates++, dst, dstAccept));
-					transDest = numStates - 1;						//keep track of transition
-				}
-				LinkedList_add_at_end(trans, dfaTrans_new(currLLState->i, transDest, sym));		//Add transition from currLLState to transDest on character sym
-			}
-			free(iter2);
-			free(currIter);
+//Requests user input, executes input on given string
+void getUserInputNFA(NFA* nfa) {
+	char str[20];
+	printf("Enter an input string: ");
+	scanf("%s", str);
+	while (strcmp(str, "STOP") != 0) {
+		if (NFA_execute(nfa, str)) {
+			printf("Accepted.\n");
 		}
-		currIndex++;
-	}
-	free(iter1);
-	DFA* dfa = DFA_new(numStates);					//create dfa with numStates total states
-	LinkedListIterator* iter3 = LinkedList_iterator(states);
-
-	while (LinkedListIterator_has_next(iter3)) {	//iterate through states LL and create the accept arr
-		dfaState* dfaS = (dfaState*)LinkedListIterator_next(iter3);
-		DFA_set_accepting(dfa, dfaS->i, dfaS->toAccept);
-	}
-	free(iter3);
-
-	LinkedListIterator* iter4 = LinkedList_iterator(trans);
-	while (LinkedListIterator_has_next(iter4)) {	//iterate through trans LL and create tTable
-		dfaTrans* dfaT = (dfaTrans*)LinkedListIterator_next(iter4);
-		DFA_set_transition(dfa, dfaT->curr, dfaT->input, dfaT->next);
+		else {
+			printf("Rejected.\n");
+		}
+		printf("Enter an input string: ");
+		scanf("%s", str);
 	}
-	free(iter4);
-	LinkedList_free(states, true);
-	LinkedList_free(trans, true);
-	return dfa;
 }
 
 int main() {
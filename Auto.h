@@ -27,6 +27,6 @@ extern void getUserInputDFA(DFA* dfa);
 
 extern void getUserInputNFA(NFA* nfa);
 
-extern DFA* subsetConstruct(NFA* nfa);
+extern void getUserInputStaticDFA(const StaticDFA* dfa);
 
 #endif
\ No newline at end of file
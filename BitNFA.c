@@ -0,0 +1,450 @@
+/*
+* Author: Peter Hess
+* File: BitNFA.c
+*
+* Bit-parallel NFA simulation. States are split into Glushkov positions by
+* the set of symbols on each incoming transition: the transitions from q to
+* j on the symbols L give the position (j, L), and a state with no incoming
+* transitions keeps one position. States reached by epsilon moves or at
+* the start are entered at their first position; all positions of a state
+* have the same transitions out, so which one does not matter. With at
+* most 64 positions follow and close are unions over the bytes of the
+* state, looked up in tables of 256 sets per byte; with more, they are
+* unions over the positions in the state, of four words each (one AVX2
+* register when compiled with -mavx2).
+*/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "IntSet.h"
+#include "Arena.h"
+#include "nfa.h"
+#include "BitNFA.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+struct BitNFA {
+	int size;				//Number of positions
+	int nwords;				//Words in a state: 1 or BITNFA_WORDS
+	int nchunks;			//Bytes in a state of one word, for the tables
+	bool shift;				//Each position is followed only by itself and the next one
+	bool epsilon;			//Some position's closure holds more than itself
+	uint64_t* init;			//Start state
+	uint64_t* accept;		//Accepting positions
+	uint64_t* step;			//For shift: positions followed by the next one
+	uint64_t* loop;			//For shift: positions followed by themselves
+	uint64_t* mask;			//Positions entered on each byte, sigma sets
+	uint64_t* follow;		//Positions that follow each position
+	uint64_t* closure;		//Epsilon closure of each position
+	uint64_t* followTable;	//One word: follow of each value of each byte of the state, 256 per byte
+	uint64_t* closeTable;	//One word: closure of each value of each byte of the state
+	Arena* arena;			//Holds every array above
+};
+
+//Transition from src to dst on the symbols in label
+typedef struct {
+	int dst;
+	int src;
+	uint64_t label[sigma / 64];
+	int pos;				//Position (dst, label)
+}BitNFA_Pair;
+
+//True if the given label has any symbol
+static bool BitNFA_has_label(const uint64_t* label) {
+	for (int w = 0; w < sigma / 64; w++) {
+		if (label[w] != 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+//Order pairs by destination, then label, so each position's pairs are adjacent
+static int BitNFA_compare_pairs(const void* a, const void* b) {
+	const BitNFA_Pair* x = (const BitNFA_Pair*)a;
+	const BitNFA_Pair* y = (const BitNFA_Pair*)b;
+	if ((x->dst) != (y->dst)) {
+		return ((x->dst) > (y->dst)) - ((x->dst) < (y->dst));
+	}
+	for (int w = 0; w < sigma / 64; w++) {
+		if ((x->label)[w] != (y->label)[w]) {
+			return ((x->label)[w] > (y->label)[w]) - ((x->label)[w] < (y->label)[w]);
+		}
+	}
+	return ((x->src) > (y->src)) - ((x->src) < (y->src));
+}
+
+static void BitNFA_add(uint64_t* set, int pos) {
+	set[pos >> 6] |= (uint64_t)1 << (pos & 63);
+}
+
+static bool BitNFA_has(const uint64_t* set, int pos) {
+	return (set[pos >> 6] >> (pos & 63)) & 1;
+}
+
+//Store in table, for each byte k of a one-word state and each value v of it, the union of sets[8k + i] over the bits i of v
+static void BitNFA_tabulate(uint64_t* table, const uint64_t* sets, int size, int nchunks) {
+	for (int k = 0; k < nchunks; k++) {
+		for (int v = 0; v < 256; v++) {
+			uint64_t u = 0;
+			for (int i = 0; i < 8 && 8 * k + i < size; i++) {
+				if ((v >> i) & 1) {
+					u |= sets[8 * k + i];
+				}
+			}
+			table[(k << 8) | v] = u;
+		}
+	}
+}
+
+/**
+* Allocate and return the bit-parallel form of the given NFA, or NULL if
+* it needs more than BITNFA_MAX_STATES positions, or has epsilon moves and
+* is not closed.
+*/
+BitNFA* BitNFA_new(const NFA* nfa) {
+	int n = (nfa->numStates);
+	if (n == 0 || n > BITNFA_MAX_STATES || (NFA_has_epsilon(nfa) && !(nfa->closed))) {
+		return NULL;
+	}
+
+	//The label of each transition: the symbols on which src may move to dst
+	BitNFA_Pair* pairs = (BitNFA_Pair*)malloc(((size_t)(nfa->numEdges) + 1) * sizeof(BitNFA_Pair));
+	uint64_t (*labels)[sigma / 64] = (uint64_t (*)[sigma / 64])calloc(n, sizeof(uint64_t[sigma / 64]));
+	int* touched = (int*)malloc(n * sizeof(int));
+	int npairs = 0;
+	for (int q = 0; q < n; q++) {
+		const NFA_Edge* edges;
+		int nedges = NFA_get_edges(nfa, q, &edges);
+		int ntouched = 0;
+		for (int i = 0; i < nedges; i++) {
+			int dst = edges[i].dst;
+			if (!BitNFA_has_label(labels[dst])) {
+				touched[ntouched++] = dst;
+			}
+			for (int c = edges[i].lo; c <= edges[i].hi; c++) {
+				labels[dst][c >> 6] |= (uint64_t)1 << (c & 63);
+			}
+		}
+		for (int i = 0; i < ntouched; i++) {
+			int dst = touched[i];
+			BitNFA_Pair* p = &(pairs[npairs++]);
+			(p->dst) = dst;
+			(p->src) = q;
+			memcpy(p->label, labels[dst], sizeof(p->label));
+			memset(labels[dst], 0, sizeof(labels[dst]));
+		}
+	}
+	free(labels);
+	free(touched);
+	qsort(pairs, npairs, sizeof(BitNFA_Pair), BitNFA_compare_pairs);
+
+	//Number the positions in order of state, then label
+	int* first = (int*)malloc(n * sizeof(int));		//First position of each state
+	int size = 0;
+	int p = 0;
+	for (int j = 0; j < n; j++) {
+		first[j] = size;
+		if (p == npairs || pairs[p].dst != j) {
+			size++;									//Entered only by epsilon moves, or at the start
+		}
+		for (; p < npairs && pairs[p].dst == j; p++) {
+			bool sameLabel = (p > 0 && pairs[p - 1].dst == j && memcmp(pairs[p - 1].label, pairs[p].label, sizeof(pairs[p].label)) == 0);
+			pairs[p].pos = sameLabel ? pairs[p - 1].pos : size++;
+		}
+	}
+	if (size > BITNFA_MAX_STATES) {
+		free(pairs);
+		free(first);
+		return NULL;
+	}
+
+	Arena* arena = Arena_new(0);
+	BitNFA* bits = (BitNFA*)Arena_calloc(arena, 1, sizeof(BitNFA));
+	int nwords = (size <= 64) ? 1 : BITNFA_WORDS;
+	(bits->arena) = arena;
+	(bits->size) = size;
+	(bits->nwords) = nwords;
+	(bits->nchunks) = (size + 7) / 8;
+	(bits->init) = (uint64_t*)Arena_calloc(arena, nwords, sizeof(uint64_t));
+	(bits->accept) = (uint64_t*)Arena_calloc(arena, nwords, sizeof(uint64_t));
+	(bits->step) = (uint64_t*)Arena_calloc(arena, nwords, sizeof(uint64_t));
+	(bits->loop) = (uint64_t*)Arena_calloc(arena, nwords, sizeof(uint64_t));
+	(bits->mask) = (uint64_t*)Arena_calloc(arena, (size_t)256 * nwords, sizeof(uint64_t));
+	(bits->follow) = (uint64_t*)Arena_calloc(arena, (size_t)size * nwords, sizeof(uint64_t));
+	(bits->closure) = (uint64_t*)Arena_calloc(arena, (size_t)size * nwords, sizeof(uint64_t));
+
+	int* state = (int*)malloc(size * sizeof(int));	//State of each position
+	for (int j = 0; j < n; j++) {
+		int last = (j + 1 < n) ? first[j + 1] : size;
+		for (int pos = first[j]; pos < last; pos++) {
+			state[pos] = j;
+			if (NFA_get_accepting(nfa, j)) {
+				BitNFA_add(bits->accept, pos);
+			}
+		}
+	}
+	uint64_t* out = (uint64_t*)calloc((size_t)n * nwords, sizeof(uint64_t));	//Positions entered from each state
+	for (int i = 0; i < npairs; i++) {
+		BitNFA_add(out + (size_t)pairs[i].src * nwords, pairs[i].pos);
+		for (int c = 0; c < sigma; c++) {
+			if ((pairs[i].label[c >> 6] >> (c & 63)) & 1) {
+				BitNFA_add((bits->mask) + (size_t)c * nwords, pairs[i].pos);
+			}
+		}
+	}
+
+	(bits->shift) = true;
+	for (int pos = 0; pos < size; pos++) {
+		uint64_t* follow = (bits->follow) + (size_t)pos * nwords;
+		uint64_t* closure = (bits->closure) + (size_t)pos * nwords;
+		memcpy(follow, out + (size_t)state[pos] * nwords, nwords * sizeof(uint64_t));
+		BitNFA_add(closure, pos);
+		if (NFA_has_epsilon(nfa)) {
+			IntSetIterator iter;
+			IntSetIterator_init(&iter, &((nfa->closure)[state[pos]]));
+			while (IntSetIterator_has_next(&iter)) {
+				int s = IntSetIterator_next(&iter);
+				if (s != state[pos]) {
+					BitNFA_add(closure, first[s]);
+					(bits->epsilon) = true;
+				}
+			}
+		}
+		for (int next = 0; next < size; next++) {	//Shift-And needs follow(pos) to be within {pos, pos + 1}
+			if (BitNFA_has(follow, next)) {
+				if (next == pos) {
+					BitNFA_add(bits->loop, pos);
+				}
+				else if (next == pos + 1) {
+					BitNFA_add(bits->step, pos);
+				}
+				else {
+					(bits->shift) = false;
+				}
+			}
+		}
+	}
+	memcpy(bits->init, (bits->closure) + (size_t)first[0] * nwords, nwords * sizeof(uint64_t));
+
+	if (nwords == 1) {
+		(bits->closeTable) = (uint64_t*)Arena_alloc(arena, (size_t)(bits->nchunks) * 256 * sizeof(uint64_t));
+		BitNFA_tabulate(bits->closeTable, bits->closure, size, bits->nchunks);
+		if (!(bits->shift)) {
+			(bits->followTable) = (uint64_t*)Arena_alloc(arena, (size_t)(bits->nchunks) * 256 * sizeof(uint64_t));
+			BitNFA_tabulate(bits->followTable, bits->follow, size, bits->nchunks);
+		}
+	}
+	free(out);
+	free(state);
+	free(first);
+	free(pairs);
+	return bits;
+}
+
+/**
+* Free the given BitNFA.
+*/
+void BitNFA_free(BitNFA* bits) {
+	Arena_free(bits->arena);				//The BitNFA itself is in its arena
+}
+
+/**
+* Return the number of positions of the given BitNFA.
+*/
+int BitNFA_get_size(const BitNFA* bits) {
+	return (bits->size);
+}
+
+/**
+* Return the number of words in a state of the given BitNFA.
+*/
+int BitNFA_words(const BitNFA* bits) {
+	return (bits->nwords);
+}
+
+/**
+* Store the start state of the given BitNFA in state.
+*/
+void BitNFA_start(const BitNFA* bits, uint64_t* state) {
+	memcpy(state, bits->init, (bits->nwords) * sizeof(uint64_t));
+}
+
+//Union of the sets in table for the bytes of d
+static inline uint64_t BitNFA_lookup(const uint64_t* table, int nchunks, uint64_t d) {
+	uint64_t u = 0;
+	for (int k = 0; k < nchunks; k++) {
+		u |= table[(k << 8) | ((d >> (8 * k)) & 255)];
+	}
+	return u;
+}
+
+//Scan kernel for states of one word, given how to compute follow(d) and close(d)
+#define BITNFA_SCAN(name, FOLLOW, CLOSE)											\
+	static uint64_t name(const BitNFA* bits, uint64_t d, const uint8_t* buf, size_t len) {	\
+		const uint64_t* mask = (bits->mask);										\
+		uint64_t step = (bits->step)[0];											\
+		uint64_t loop = (bits->loop)[0];											\
+		int nchunks = (bits->nchunks);												\
+		(void)step;																	\
+		(void)loop;																	\
+		(void)nchunks;																\
+		for (size_t i = 0; i < len && d != 0; i++) {								\
+			d = (FOLLOW) & mask[buf[i]];											\
+			d = (CLOSE);															\
+		}																			\
+		return d;																	\
+	}
+
+BITNFA_SCAN(BitNFA_scan_shift, ((d & step) << 1) | (d & loop), d)
+BITNFA_SCAN(BitNFA_scan_shift_close, ((d & step) << 1) | (d & loop), BitNFA_lookup(bits->closeTable, nchunks, d))
+BITNFA_SCAN(BitNFA_scan_table, BitNFA_lookup(bits->followTable, nchunks, d), d)
+BITNFA_SCAN(BitNFA_scan_table_close, BitNFA_lookup(bits->followTable, nchunks, d), BitNFA_lookup(bits->closeTable, nchunks, d))
+
+#if defined(__AVX2__)
+
+//Union of the sets of the positions in d, each of four words
+static inline __m256i BitNFA_union(const uint64_t* sets, __m256i d) {
+	uint64_t words[BITNFA_WORDS];
+	_mm256_storeu_si256((__m256i*)words, d);
+	__m256i u = _mm256_setzero_si256();
+	for (int w = 0; w < BITNFA_WORDS; w++) {
+		for (uint64_t b = words[w]; b != 0; b &= b - 1) {
+			u = _mm256_or_si256(u, _mm256_loadu_si256((const __m256i*)(sets + (size_t)(64 * w + IntSet_ctz(b)) * BITNFA_WORDS)));
+		}
+	}
+	return u;
+}
+
+//Scan kernel for states of four words, in one AVX2 register
+static bool BitNFA_scan_wide(const BitNFA* bits, uint64_t* state, const uint8_t* buf, size_t len) {
+	__m256i d = _mm256_loadu_si256((const __m256i*)state);
+	__m256i step = _mm256_loadu_si256((const __m256i*)(bits->step));
+	__m256i loop = _mm256_loadu_si256((const __m256i*)(bits->loop));
+	bool alive = !_mm256_testz_si256(d, d);
+	for (size_t i = 0; i < len && alive; i++) {
+		__m256i f;
+		if ((bits->shift)) {
+			__m256i s = _mm256_and_si256(d, step);
+			__m256i carry = _mm256_srli_epi64(_mm256_permute4x64_epi64(s, 0x90), 63);	//Top bit of the word below
+			carry = _mm256_blend_epi32(carry, _mm256_setzero_si256(), 0x03);
+			f = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi64(s, 1), carry), _mm256_and_si256(d, loop));
+		}
+		else {
+			f = BitNFA_union(bits->follow, d);
+		}
+		d = _mm256_and_si256(f, _mm256_loadu_si256((const __m256i*)((bits->mask) + (size_t)buf[i] * BITNFA_WORDS)));
+		if ((bits->epsilon)) {
+			d = BitNFA_union(bits->closure, d);
+		}
+		alive = !_mm256_testz_si256(d, d);
+	}
+	_mm256_storeu_si256((__m256i*)state, d);
+	return alive;
+}
+
+#else
+
+//Store in u the union of the sets of the positions in d, each of four words
+static inline void BitNFA_union(const uint64_t* sets, const uint64_t* d, uint64_t* u) {
+	memset(u, 0, BITNFA_WORDS * sizeof(uint64_t));
+	for (int w = 0; w < BITNFA_WORDS; w++) {
+		for (uint64_t b = d[w]; b != 0; b &= b - 1) {
+			const uint64_t* set = sets + (size_t)(64 * w + IntSet_ctz(b)) * BITNFA_WORDS;
+			for (int k = 0; k < BITNFA_WORDS; k++) {
+				u[k] |= set[k];
+			}
+		}
+	}
+}
+
+//Scan kernel for states of four words, shift only, with the state in four registers
+static bool BitNFA_scan_wide_shift(const BitNFA* bits, uint64_t* state, const uint8_t* buf, size_t len) {
+	const uint64_t* step = (bits->step);
+	const uint64_t* loop = (bits->loop);
+	uint64_t s0 = step[0], s1 = step[1], s2 = step[2], s3 = step[3];
+	uint64_t l0 = loop[0], l1 = loop[1], l2 = loop[2], l3 = loop[3];
+	uint64_t d0 = state[0], d1 = state[1], d2 = state[2], d3 = state[3];
+	for (size_t i = 0; i < len && (d0 | d1 | d2 | d3) != 0; i++) {
+		const uint64_t* mask = (bits->mask) + (size_t)buf[i] * BITNFA_WORDS;
+		uint64_t t0 = d0 & s0, t1 = d1 & s1, t2 = d2 & s2, t3 = d3 & s3;
+		d3 = ((t3 << 1) | (t2 >> 63) | (d3 & l3)) & mask[3];	//Each word takes the top bit of the word below
+		d2 = ((t2 << 1) | (t1 >> 63) | (d2 & l2)) & mask[2];
+		d1 = ((t1 << 1) | (t0 >> 63) | (d1 & l1)) & mask[1];
+		d0 = ((t0 << 1) | (d0 & l0)) & mask[0];
+	}
+	state[0] = d0;
+	state[1] = d1;
+	state[2] = d2;
+	state[3] = d3;
+	return (d0 | d1 | d2 | d3) != 0;
+}
+
+//Scan kernel for states of four words
+static bool BitNFA_scan_wide(const BitNFA* bits, uint64_t* state, const uint8_t* buf, size_t len) {
+	if ((bits->shift) && !(bits->epsilon)) {
+		return BitNFA_scan_wide_shift(bits, state, buf, len);
+	}
+	uint64_t d[BITNFA_WORDS];
+	uint64_t f[BITNFA_WORDS];
+	memcpy(d, state, sizeof(d));
+	uint64_t any = d[0] | d[1] | d[2] | d[3];
+	for (size_t i = 0; i < len && any != 0; i++) {
+		if ((bits->shift)) {
+			uint64_t carry = 0;						//Top bit of the word below
+			for (int w = 0; w < BITNFA_WORDS; w++) {
+				uint64_t s = d[w] & (bits->step)[w];
+				f[w] = (s << 1) | carry | (d[w] & (bits->loop)[w]);
+				carry = s >> 63;
+			}
+		}
+		else {
+			BitNFA_union(bits->follow, d, f);
+		}
+		const uint64_t* mask = (bits->mask) + (size_t)buf[i] * BITNFA_WORDS;
+		for (int w = 0; w < BITNFA_WORDS; w++) {
+			d[w] = f[w] & mask[w];
+		}
+		if ((bits->epsilon)) {
+			BitNFA_union(bits->closure, d, f);
+			memcpy(d, f, sizeof(d));
+		}
+		any = d[0] | d[1] | d[2] | d[3];
+	}
+	memcpy(state, d, sizeof(d));
+	return any != 0;
+}
+
+#endif
+
+/**
+* Advance state over the next len bytes of input. Returns false once no
+* position is left.
+*/
+bool BitNFA_feed(const BitNFA* bits, uint64_t* state, const uint8_t* buf, size_t len) {
+	if ((bits->nwords) != 1) {
+		return BitNFA_scan_wide(bits, state, buf, len);
+	}
+	if ((bits->shift)) {
+		state[0] = (bits->epsilon) ? BitNFA_scan_shift_close(bits, state[0], buf, len) : BitNFA_scan_shift(bits, state[0], buf, len);
+	}
+	else {
+		state[0] = (bits->epsilon) ? BitNFA_scan_table_close(bits, state[0], buf, len) : BitNFA_scan_table(bits, state[0], buf, len);
+	}
+	return state[0] != 0;
+}
+
+/**
+* Return true if state contains an accepting position.
+*/
+bool BitNFA_accepting(const BitNFA* bits, const uint64_t* state) {
+	uint64_t any = 0;
+	for (int w = 0; w < (bits->nwords); w++) {
+		any |= state[w] & (bits->accept)[w];
+	}
+	return any != 0;
+}
@@ -0,0 +1,76 @@
+/*
+* Author: Peter Hess
+* File: BitNFA.h
+*
+* Bit-parallel simulation of small NFAs: the set of current states is held
+* in one machine word (or four, for up to 256 states), and each input byte
+* advances all of them at once with a few shifts, table lookups and masks.
+*/
+
+#ifndef _BitNFA_h
+#define _BitNFA_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "nfa.h"
+
+#define BITNFA_MAX_STATES 256	//Most positions of a BitNFA
+#define BITNFA_WORDS 4			//Words in the state of a BitNFA with more than 64 positions
+
+/**
+* Glushkov form of an NFA. Each state is split into one position per set
+* of symbols on which it is entered, so that every position is entered on
+* a single set of symbols, mask[c] holds the positions entered on c, and
+* a step is
+*     D' = close(follow(D) & mask[c])
+* where follow(D) is the union of the positions that follow those in D,
+* found with one table lookup per byte of D, or as ((D & step) << 1) |
+* (D & loop) when each position is followed only by itself and the next
+* one (Shift-And), and close adds the epsilon closures of the positions.
+* A BitNFA is not modified by running it, so one may be used on many
+* threads at once.
+*/
+typedef struct BitNFA BitNFA;
+
+/**
+* Allocate and return the bit-parallel form of the given NFA, or NULL if
+* it needs more than BITNFA_MAX_STATES positions, or has epsilon moves and
+* is not closed. The NFA is not needed once this returns. NFA_compress
+* calls this, and NFA_execute and NFA_feed use the result when there is one.
+*/
+extern BitNFA* BitNFA_new(const NFA* nfa);
+
+/**
+* Free the given BitNFA.
+*/
+extern void BitNFA_free(BitNFA* bits);
+
+/**
+* Return the number of positions of the given BitNFA.
+*/
+extern int BitNFA_get_size(const BitNFA* bits);
+
+/**
+* Return the number of words in a state of the given BitNFA: 1 for up to
+* 64 positions, otherwise BITNFA_WORDS.
+*/
+extern int BitNFA_words(const BitNFA* bits);
+
+/**
+* Store the start state of the given BitNFA in state.
+*/
+extern void BitNFA_start(const BitNFA* bits, uint64_t* state);
+
+/**
+* Advance state over the next len bytes of input. Returns false once no
+* position is left, after which the input can no longer be accepted.
+*/
+extern bool BitNFA_feed(const BitNFA* bits, uint64_t* state, const uint8_t* buf, size_t len);
+
+/**
+* Return true if state contains an accepting position.
+*/
+extern bool BitNFA_accepting(const BitNFA* bits, const uint64_t* state);
+
+#endif
@@ -0,0 +1,75 @@
+/*
+* Author: Peter Hess
+* File: ByteClass.c
+*
+* Alphabet compression into equivalence classes of symbols.
+*/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "ByteClass.h"
+
+/**
+* Partition the symbols 0..sigma-1 into classes, writing the class of each
+* symbol to classes and returning the number of classes. Two symbols share
+* a class iff same(ctx, sym1, sym2) is true; hash(ctx, sym) must agree for
+* such symbols. Classes are numbered in order of their smallest symbol.
+*/
+int ByteClass_partition(uint8_t* classes, uint64_t(*hash)(const void* ctx, int sym),
+	bool(*same)(const void* ctx, int sym1, int sym2), const void* ctx) {
+	uint64_t repHash[sigma];		//Hash of each class's column
+	int rep[sigma];					//Smallest symbol of each class
+	int nclasses = 0;
+
+	for (int sym = 0; sym < sigma; sym++) {
+		uint64_t h = hash(ctx, sym);
+		int c = 0;
+		while (c < nclasses && (repHash[c] != h || !same(ctx, rep[c], sym))) {	//Compare full columns only on a hash match
+			c++;
+		}
+		if (c == nclasses) {		//sym starts a new class
+			repHash[c] = h;
+			rep[c] = sym;
+			nclasses++;
+		}
+		classes[sym] = (uint8_t)c;
+	}
+	return nclasses;
+}
+
+/**
+* Fill classes with the identity map (every symbol in its own class) and
+* return the number of classes, sigma.
+*/
+int ByteClass_identity(uint8_t* classes) {
+	for (int sym = 0; sym < sigma; sym++) {
+		classes[sym] = (uint8_t)sym;
+	}
+	return sigma;
+}
+
+/**
+* Fill classes with one class for each ASCII symbol and one more for all
+* the bytes of 128 and above, and return the number of classes, 129.
+*/
+int ByteClass_ascii(uint8_t* classes) {
+	for (int sym = 0; sym < sigma; sym++) {
+		classes[sym] = (uint8_t)((sym < 128) ? sym : 128);
+	}
+	return 129;
+}
+
+/**
+* Store in reps the smallest symbol of each of the nclasses classes.
+*/
+void ByteClass_representatives(const uint8_t* classes, int nclasses, int* reps) {
+	for (int c = 0; c < nclasses; c++) {
+		reps[c] = -1;
+	}
+	for (int sym = 0; sym < sigma; sym++) {
+		if (reps[classes[sym]] == -1) {
+			reps[classes[sym]] = sym;
+		}
+	}
+}
@@ -0,0 +1,44 @@
+/*
+* Author: Peter Hess
+* File: ByteClass.h
+*
+* Alphabet compression: partitions the input symbols into equivalence
+* classes of symbols that no transition table tells apart, so tables need
+* one column per class instead of one per symbol.
+*/
+
+#ifndef _ByteClass_h
+#define _ByteClass_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define sigma 256
+
+/**
+* Partition the symbols 0..sigma-1 into classes, writing the class of each
+* symbol to classes and returning the number of classes. Two symbols share
+* a class iff same(ctx, sym1, sym2) is true; hash(ctx, sym) must agree for
+* such symbols. Classes are numbered in order of their smallest symbol.
+*/
+extern int ByteClass_partition(uint8_t* classes, uint64_t(*hash)(const void* ctx, int sym),
+	bool(*same)(const void* ctx, int sym1, int sym2), const void* ctx);
+
+/**
+* Fill classes with the identity map (every symbol in its own class) and
+* return the number of classes, sigma.
+*/
+extern int ByteClass_identity(uint8_t* classes);
+
+/**
+* Fill classes with one class for each ASCII symbol and one more for all
+* the bytes of 128 and above, and return the number of classes, 129.
+*/
+extern int ByteClass_ascii(uint8_t* classes);
+
+/**
+* Store in reps the smallest symbol of each of the nclasses classes.
+*/
+extern void ByteClass_representatives(const uint8_t* classes, int nclasses, int* reps);
+
+#endif
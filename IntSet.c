@@ -5,19 +5,31 @@
 * Time-stamp: <Tue Aug  8 10:11:39 EDT 2017 ferguson>
 *
 * IntSet implemented as a bit vector.
-* Using long long should allow values from 0 to 63.
+* The vector is an array of 64-bit words, sized when the set is created.
 *
 * Note (PH): Minor edits have been made to ensure compatability.
 */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <stdbool.h>
 #include "IntSet.h"
+#include "Arena.h"
 
-IntSet* IntSet_new() {
-	IntSet* set1 = (IntSet*)malloc(sizeof(IntSet));
-	(set1->bits) = 0;
+//The struct and its words are allocated together, so a single free releases both
+IntSet* IntSet_new(int size) {
+	int nwords = IntSet_words_for(size);
+	IntSet* set1 = (IntSet*)malloc(sizeof(IntSet) + nwords * sizeof(uint64_t));
+	IntSet_init(set1, size, (uint64_t*)(set1 + 1));
+	return set1;
+}
+
+//Allocate the set from arena, which owns it: it must not be passed to IntSet_free
+IntSet* IntSet_new_in(Arena* arena, int size) {
+	int nwords = IntSet_words_for(size);
+	IntSet* set1 = (IntSet*)Arena_alloc(arena, sizeof(IntSet) + nwords * sizeof(uint64_t));
+	IntSet_init(set1, size, (uint64_t*)(set1 + 1));
 	return set1;
 }
 
@@ -27,62 +39,123 @@ void IntSet_free(IntSet* set) {
 	}
 }
 
-bool IntSet_is_empty(IntSet* set) {
-	return ((set->bits) == 0);
+int IntSet_words_for(int size) {
+	return (size + 63) / 64;
+}
+
+//Initialize set to be empty, using the given caller-owned words (IntSet_words_for(size) of them)
+void IntSet_init(IntSet* set, int size, uint64_t* words) {
+	(set->size) = size;
+	(set->nwords) = IntSet_words_for(size);
+	(set->words) = words;
+	IntSet_clear(set);
+}
+
+bool IntSet_is_empty(const IntSet* set) {
+	for (int i = 0; i < (set->nwords); i++) {
+		if ((set->words)[i] != 0) {
+			return false;
+		}
+	}
+	return true;
 }
 
 void IntSet_add(IntSet* set, int value) {
-	if (value < 0 || value >= 32) {
+	if (value < 0 || value >= (set->size)) {
 		fprintf(stderr, "IntSet_add: value out of range: %d\n", value);
 		abort();
 	}
-	(set->bits) |= (1L << value);
+	(set->words)[value >> 6] |= (1ULL << (value & 63));
+}
+
+void IntSet_clear(IntSet* set) {
+	memset(set->words, 0, (set->nwords) * sizeof(uint64_t));
 }
 
 bool IntSet_contains(const IntSet* set, int value) {
-	return (set->bits) & (1L << value);
+	if (value < 0 || value >= (set->size)) {
+		return false;
+	}
+	return ((set->words)[value >> 6] >> (value & 63)) & 1;
+}
+
+void IntSet_copy(IntSet* dst, const IntSet* src) {
+	memcpy(dst->words, src->words, (dst->nwords) * sizeof(uint64_t));
 }
 
 void IntSet_union(IntSet* set1, const IntSet* set2) {
-	set1->bits |= set2->bits;
+	uint64_t* w1 = (set1->words);
+	const uint64_t* w2 = (set2->words);
+	for (int i = 0; i < (set1->nwords); i++) {
+		w1[i] |= w2[i];
+	}
 }
 
-bool IntSet_equals(IntSet* set1, IntSet* set2) {
-	return (set1->bits) == (set2->bits);
+bool IntSet_equals(const IntSet* set1, const IntSet* set2) {
+	return (set1->nwords) == (set2->nwords)
+		&& memcmp(set1->words, set2->words, (set1->nwords) * sizeof(uint64_t)) == 0;
 }
 
-IntSetIterator* IntSet_iterator(IntSet* set) {
+//True if every member of set1 is in set2; both must have the same size
+bool IntSet_is_subset(const IntSet* set1, const IntSet* set2) {
+	for (int i = 0; i < (set1->nwords); i++) {
+		if (((set1->words)[i] & ~(set2->words)[i]) != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+uint64_t IntSet_hash(const IntSet* set) {
+	uint64_t h = 0;
+	for (int i = 0; i < (set->nwords); i++) {
+		h = (h ^ (set->words)[i]) * 0x9e3779b97f4a7c15ULL;
+	}
+	h ^= h >> 30;								//splitmix64 finalizer, so nearby sets spread over the table
+	h *= 0xbf58476d1ce4e5b9ULL;
+	h ^= h >> 27;
+	h *= 0x94d049bb133111ebULL;
+	h ^= h >> 31;
+	return h;
+}
+
+IntSetIterator* IntSet_iterator(const IntSet* set) {
 	IntSetIterator* iterator = (IntSetIterator*)malloc(sizeof(IntSetIterator));
-	(iterator->index) = 0;
-	(iterator->set) = set;
+	IntSetIterator_init(iterator, set);
 	return iterator;
 }
 
+//Initialize an iterator in place (e.g. on the stack), avoiding the malloc in IntSet_iterator
+void IntSetIterator_init(IntSetIterator* iterator, const IntSet* set) {
+	(iterator->set) = set;
+	(iterator->index) = 0;
+	(iterator->bits) = ((set->nwords) > 0) ? (set->words)[0] : 0;
+}
+
 bool IntSetIterator_has_next(IntSetIterator* iterator) {
-	while ((iterator->index) < 32) {
-		if (IntSet_contains(iterator->set, iterator->index)) {
-			return true;
-		}
-		else {
-			(iterator->index) = (iterator->index) + 1;
+	while ((iterator->bits) == 0) {				//Skip whole empty words
+		if ((iterator->index) + 1 >= (iterator->set->nwords)) {
+			return false;
 		}
+		(iterator->index) += 1;
+		(iterator->bits) = (iterator->set->words)[iterator->index];
 	}
-	return false;
+	return true;
 }
 
 int IntSetIterator_next(IntSetIterator* iterator) {
-	int value = iterator->index;
-	(iterator->index) += 1;
+	int value = (iterator->index) * 64 + IntSet_ctz(iterator->bits);
+	(iterator->bits) &= (iterator->bits) - 1;	//Clear lowest set bit
 	return value;
 }
 
-void IntSet_print(IntSet* set) {
-	IntSetIterator* iterator = IntSet_iterator(set);
+void IntSet_print(const IntSet* set) {
+	IntSetIterator iterator;
+	IntSetIterator_init(&iterator, set);
 	printf("{");
-	while (IntSetIterator_has_next(iterator)) {
-		int value = IntSetIterator_next(iterator);
+	while (IntSetIterator_has_next(&iterator)) {
+		int value = IntSetIterator_next(&iterator);
 		printf("%d,", value);
 	}
 	printf("}\n");
-	free(iterator);
-}
\ No newline at end of file
+}
@@ -5,45 +5,80 @@
 * Time-stamp: <Fri Aug  4 09:31:27 EDT 2017 ferguson>
 
 * Note: Minor edits have been made to ensure compatability
+* Note (PH): Sets are now multi-word bit vectors whose width is fixed when
+* the set is created, so they can hold any number of NFA states.
 */
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include "Arena.h"
 
 #ifndef _IntSet_h
 #define _IntSet_h
 
+//Index of the lowest set bit of a nonzero word
+#if defined(_MSC_VER)
+#include <intrin.h>
+static __inline int IntSet_ctz(uint64_t x) {
+	unsigned long index;
+	_BitScanForward64(&index, x);
+	return (int)index;
+}
+#else
+#define IntSet_ctz(x) __builtin_ctzll(x)
+#endif
+
 typedef struct IntSet {
-	unsigned long long bits;
+	int size;			//Values range over 0..size-1
+	int nwords;
+	uint64_t* words;
 }IntSet;
 
 typedef struct IntSetIterator {
-	IntSet* set;
-	int index;
+	const IntSet* set;
+	int index;			//Index of the word held in bits
+	uint64_t bits;		//Members of that word not yet returned
 }IntSetIterator;
 
-extern IntSet* IntSet_new();
+extern IntSet* IntSet_new(int size);
+
+//Allocate the set from arena, which owns it: it must not be passed to IntSet_free
+extern IntSet* IntSet_new_in(Arena* arena, int size);
 
 extern void IntSet_free(IntSet* set);
 
-bool IntSet_is_empty(IntSet* set);
+int IntSet_words_for(int size);
+
+void IntSet_init(IntSet* set, int size, uint64_t* words);
+
+bool IntSet_is_empty(const IntSet* set);
 
 void IntSet_add(IntSet* set, int value);
 
+void IntSet_clear(IntSet* set);
+
 bool IntSet_contains(const IntSet* set, int value);
 
+void IntSet_copy(IntSet* dst, const IntSet* src);
+
 void IntSet_union(IntSet* set1, const IntSet* set2);
 
-bool IntSet_equals(IntSet* set1, IntSet* set2);
+bool IntSet_equals(const IntSet* set1, const IntSet* set2);
+
+bool IntSet_is_subset(const IntSet* set1, const IntSet* set2);
+
+uint64_t IntSet_hash(const IntSet* set);
+
+IntSetIterator* IntSet_iterator(const IntSet* set);
 
-IntSetIterator* IntSet_iterator(IntSet* set);
+void IntSetIterator_init(IntSetIterator* iterator, const IntSet* set);
 
 bool IntSetIterator_has_next(IntSetIterator* iterator);
 
 int IntSetIterator_next(IntSetIterator* iterator);
 
-void IntSet_print(IntSet* set);
+void IntSet_print(const IntSet* set);
 
-#endif
\ No newline at end of file
+#endif
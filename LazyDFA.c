@@ -0,0 +1,241 @@
+/*
+* Author: Peter Hess
+* File: LazyDFA.c
+*
+* Lazy subset construction, in the style of RE2's DFA: a transition is
+* computed (with the same successor step as subsetConstruct) the first time
+* the input takes it, and cached in a table. Each DFA state's set of NFA
+* states lives in one block of words, indexed by a SetMap. When a new state
+* would take the cache past its budget, every state is dropped and the
+* cache starts again from the start state.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "nfa.h"
+#include "IntSet.h"
+#include "SetMap.h"
+#include "ByteClass.h"
+#include "subset.h"
+#include "LazyDFA.h"
+
+#define HALT -1
+#define UNKNOWN -2			//Transition not computed yet
+#define MIN_STATES 2		//The start state and one more
+#define MIN_BYTES_PER_STATE 10	//Below this many bytes per state built between flushes, the cache is not paying off
+
+struct LazyDFA {
+	const NFA* nfa;
+	int nclasses;
+	uint8_t classes[sigma];
+	int reps[sigma];		//A symbol of each class
+	int nwords;				//Words in each set of NFA states
+	int size;				//Number of cached DFA states; state 0 is the start state
+	int capacity;			//Number of states there is room for
+	int maxStates;			//Most states the budget allows
+	uint64_t* words;		//Set of NFA states of each DFA state, nwords each
+	IntSet* sets;			//Views of words, used as SetMap keys
+	bool* accept;
+	int* tTable;			//capacity by nclasses transitions, UNKNOWN until taken
+	SetMap* index;			//Maps each set of NFA states to its cached DFA state
+	IntSet start;			//Epsilon closure of {0}
+	IntSet next;			//Successor being computed
+	uint64_t* scratch;		//Words of start and next
+	int flushes;
+	size_t sinceFlush;		//Bytes scanned, over all calls, since the cache was last flushed
+};
+
+//Bytes of cache used by each DFA state, counting its share of a SetMap that may be a quarter full
+static size_t LazyDFA_state_bytes(int nwords, int nclasses) {
+	return nwords * sizeof(uint64_t) + sizeof(IntSet) + nclasses * sizeof(int) + sizeof(bool)
+		+ 4 * (sizeof(IntSet*) + sizeof(int) + sizeof(uint64_t));
+}
+
+//Make room for more states, pointing the sets at the moved words and indexing them again
+static void LazyDFA_grow(LazyDFA* ldfa) {
+	int capacity = (ldfa->capacity) == 0 ? 16 : 2 * (ldfa->capacity);
+	if (capacity > (ldfa->maxStates)) {
+		capacity = (ldfa->maxStates);
+	}
+	(ldfa->capacity) = capacity;
+	(ldfa->words) = (uint64_t*)realloc(ldfa->words, (size_t)capacity * (ldfa->nwords) * sizeof(uint64_t));
+	(ldfa->sets) = (IntSet*)realloc(ldfa->sets, capacity * sizeof(IntSet));
+	(ldfa->accept) = (bool*)realloc(ldfa->accept, capacity * sizeof(bool));
+	(ldfa->tTable) = (int*)realloc(ldfa->tTable, (size_t)capacity * (ldfa->nclasses) * sizeof(int));
+
+	SetMap_clear(ldfa->index);
+	for (int i = 0; i < (ldfa->size); i++) {
+		(ldfa->sets)[i].words = (ldfa->words) + (size_t)i * (ldfa->nwords);
+		SetMap_put(ldfa->index, &((ldfa->sets)[i]), i);
+	}
+}
+
+//Add a copy of the given set as a new DFA state with no transitions computed, and return its index
+static int LazyDFA_add(LazyDFA* ldfa, const IntSet* val) {
+	if ((ldfa->size) == (ldfa->capacity)) {
+		LazyDFA_grow(ldfa);
+	}
+	int n = (ldfa->size)++;
+	IntSet* set = &((ldfa->sets)[n]);
+	IntSet_init(set, (ldfa->nfa->numStates), (ldfa->words) + (size_t)n * (ldfa->nwords));
+	IntSet_copy(set, val);
+	(ldfa->accept)[n] = subsetAccepting(ldfa->nfa, set);
+	for (int c = 0; c < (ldfa->nclasses); c++) {
+		(ldfa->tTable)[(size_t)n * (ldfa->nclasses) + c] = UNKNOWN;
+	}
+	SetMap_put(ldfa->index, set, n);
+	return n;
+}
+
+//Drop every cached state, leaving only the start state
+static void LazyDFA_flush(LazyDFA* ldfa) {
+	(ldfa->size) = 0;
+	SetMap_clear(ldfa->index);
+	LazyDFA_add(ldfa, &(ldfa->start));
+}
+
+//Compute and cache the transition from state src on class cls, and return its destination.
+//If the cache has to be flushed, src no longer exists and the transition is not recorded.
+static int LazyDFA_step(LazyDFA* ldfa, int src, int cls) {
+	subsetSuccessor(ldfa->nfa, &((ldfa->sets)[src]), (ldfa->reps)[cls], &(ldfa->next));
+	int dst = HALT;
+	if (!IntSet_is_empty(&(ldfa->next))) {
+		dst = SetMap_get(ldfa->index, &(ldfa->next));
+		if (dst == -1) {
+			if ((ldfa->size) == (ldfa->maxStates)) {	//Over budget: start again from the start state
+				LazyDFA_flush(ldfa);
+				(ldfa->flushes) += 1;
+				dst = SetMap_get(ldfa->index, &(ldfa->next));
+				return (dst == -1) ? LazyDFA_add(ldfa, &(ldfa->next)) : dst;
+			}
+			dst = LazyDFA_add(ldfa, &(ldfa->next));
+		}
+	}
+	(ldfa->tTable)[(size_t)src * (ldfa->nclasses) + cls] = dst;
+	return dst;
+}
+
+/**
+* Allocate and return a new, empty LazyDFA for the given NFA, whose cache
+* of states and transitions may use up to budget bytes.
+*/
+LazyDFA* LazyDFA_new(const NFA* nfa, size_t budget) {
+	LazyDFA* ldfa = (LazyDFA*)malloc(sizeof(LazyDFA));
+	(ldfa->nfa) = nfa;
+	(ldfa->nclasses) = NFA_get_classes(nfa, ldfa->classes);		//Symbols in a class always lead to the same subset
+	ByteClass_representatives(ldfa->classes, ldfa->nclasses, ldfa->reps);
+	(ldfa->nwords) = IntSet_words_for(nfa->numStates);
+
+	size_t most = budget / LazyDFA_state_bytes(ldfa->nwords, ldfa->nclasses);
+	(ldfa->maxStates) = (most < MIN_STATES) ? MIN_STATES : (most > INT32_MAX / 2) ? INT32_MAX / 2 : (int)most;
+	(ldfa->size) = 0;
+	(ldfa->capacity) = 0;
+	(ldfa->words) = NULL;
+	(ldfa->sets) = NULL;
+	(ldfa->accept) = NULL;
+	(ldfa->tTable) = NULL;
+	(ldfa->index) = SetMap_new();
+	(ldfa->scratch) = (uint64_t*)malloc(2 * (ldfa->nwords) * sizeof(uint64_t));
+	IntSet_init(&(ldfa->start), nfa->numStates, ldfa->scratch);
+	IntSet_init(&(ldfa->next), nfa->numStates, (ldfa->scratch) + (ldfa->nwords));
+	IntSet_clear(&(ldfa->start));
+	IntSet_add(&(ldfa->start), 0);
+	NFA_close_set(nfa, &(ldfa->start));
+	(ldfa->flushes) = 0;
+	(ldfa->sinceFlush) = 0;
+
+	LazyDFA_flush(ldfa);
+	return ldfa;
+}
+
+/**
+* Free the given LazyDFA (but not its NFA).
+*/
+void LazyDFA_free(LazyDFA* ldfa) {
+	free(ldfa->words);
+	free(ldfa->sets);
+	free(ldfa->accept);
+	free(ldfa->tTable);
+	free(ldfa->scratch);
+	SetMap_free(ldfa->index);
+	free(ldfa);
+}
+
+//Finish the input from the given cached state, reached after pos bytes, by simulating the NFA, when the
+//cache keeps being flushed. A bit-parallel NFA starts again from the beginning, as its positions cannot
+//be recovered from the state, but it is fast enough that scanning the first pos bytes again still pays.
+static bool LazyDFA_finish_nfa(LazyDFA* ldfa, int state, const uint8_t* input, size_t pos, size_t len) {
+	NFA_Context* ctx = NFA_context_new(ldfa->nfa);
+	if ((ldfa->nfa->bits) == NULL) {
+		NFA_context_set(ctx, &((ldfa->sets)[state]));
+		NFA_feed(ctx, input + pos, len - pos);
+	}
+	else {
+		NFA_feed(ctx, input, len);
+	}
+	bool accepted = NFA_finish(ctx);
+	NFA_context_free(ctx);
+	return accepted;
+}
+
+/**
+* Run the given LazyDFA on len bytes of input, and return true if its NFA
+* accepts them, otherwise false.
+*/
+bool LazyDFA_match(LazyDFA* ldfa, const uint8_t* input, size_t len) {
+	const int* tTable = (ldfa->tTable);
+	size_t stride = (ldfa->nclasses);
+	int flushes = (ldfa->flushes);
+	size_t before = (ldfa->sinceFlush);				//Bytes since the last flush when input[lastFlush] was reached
+	size_t lastFlush = 0;
+	int state = 0;
+	for (size_t i = 0; i < len; i++) {
+		int cls = (ldfa->classes)[input[i]];
+		int next = tTable[state * stride + cls];
+		if (next == UNKNOWN) {							//First time here: build the state, which may move the table
+			next = LazyDFA_step(ldfa, state, cls);
+			tTable = (ldfa->tTable);
+			if ((ldfa->flushes) != flushes) {
+				flushes = (ldfa->flushes);
+				if (before + (i - lastFlush) < (size_t)MIN_BYTES_PER_STATE * (ldfa->maxStates) && next != HALT) {	//Thrashing: the NFA is cheaper
+					(ldfa->sinceFlush) = 0;
+					return LazyDFA_finish_nfa(ldfa, next, input, i + 1, len);
+				}
+				before = 0;
+				lastFlush = i;
+			}
+		}
+		if (next == HALT) {								//Reject if no transition is available
+			(ldfa->sinceFlush) = before + (i + 1 - lastFlush);
+			return false;
+		}
+		state = next;
+	}
+	(ldfa->sinceFlush) = before + (len - lastFlush);
+	return (ldfa->accept)[state];
+}
+
+/**
+* Run the given LazyDFA on the given input string, and return true if its
+* NFA accepts the input, otherwise false.
+*/
+bool LazyDFA_execute(LazyDFA* ldfa, const char* input) {
+	return LazyDFA_match(ldfa, (const uint8_t*)input, strlen(input));
+}
+
+/**
+* Return the number of DFA states in the given LazyDFA's cache.
+*/
+int LazyDFA_get_size(const LazyDFA* ldfa) {
+	return (ldfa->size);
+}
+
+/**
+* Return the number of times the given LazyDFA's cache has been flushed
+* because it reached its memory budget.
+*/
+int LazyDFA_get_flushes(const LazyDFA* ldfa) {
+	return (ldfa->flushes);
+}
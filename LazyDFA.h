@@ -0,0 +1,61 @@
+/*
+* Author: Peter Hess
+* File: LazyDFA.h
+*
+* Lazily built DFA: runs an NFA at close to DFA speed by constructing DFA
+* states from sets of NFA states only when the input first reaches them.
+*/
+
+#ifndef _LazyDFA_h
+#define _LazyDFA_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "nfa.h"
+
+/**
+* Cache of the DFA states and transitions found so far for one NFA. The
+* cache never uses more than its memory budget: when it is full it is
+* flushed and rebuilt from the states the input goes on to reach.
+* A LazyDFA changes as it runs, so each thread needs its own.
+*/
+typedef struct LazyDFA LazyDFA;
+
+/**
+* Allocate and return a new, empty LazyDFA for the given NFA, whose cache
+* of states and transitions may use up to budget bytes. The NFA must not
+* change or be freed while the LazyDFA is in use.
+*/
+extern LazyDFA* LazyDFA_new(const NFA* nfa, size_t budget);
+
+/**
+* Free the given LazyDFA (but not its NFA).
+*/
+extern void LazyDFA_free(LazyDFA* ldfa);
+
+/**
+* Run the given LazyDFA on the given input string, and return true if its
+* NFA accepts the input, otherwise false. States built along the way stay
+* in the cache for later inputs.
+*/
+extern bool LazyDFA_execute(LazyDFA* ldfa, const char* input);
+
+/**
+* Run the given LazyDFA on len bytes of input, and return true if its NFA
+* accepts them, otherwise false.
+*/
+extern bool LazyDFA_match(LazyDFA* ldfa, const uint8_t* input, size_t len);
+
+/**
+* Return the number of DFA states in the given LazyDFA's cache.
+*/
+extern int LazyDFA_get_size(const LazyDFA* ldfa);
+
+/**
+* Return the number of times the given LazyDFA's cache has been flushed
+* because it reached its memory budget.
+*/
+extern int LazyDFA_get_flushes(const LazyDFA* ldfa);
+
+#endif
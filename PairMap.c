@@ -0,0 +1,108 @@
+/*
+* Author: Peter Hess
+* File: PairMap.c
+*
+* Hash map from pairs of ints to integer ids, using open addressing with
+* linear probing. Each pair is packed into one 64-bit key. The table is
+* kept at most half full.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "PairMap.h"
+
+#define INITIAL_CAPACITY 64
+
+/**
+* Allocate and return a new, empty PairMap.
+*/
+PairMap* PairMap_new() {
+	PairMap* map = (PairMap*)malloc(sizeof(PairMap));
+	(map->capacity) = INITIAL_CAPACITY;
+	(map->size) = 0;
+	(map->keys) = (uint64_t*)malloc(INITIAL_CAPACITY * sizeof(uint64_t));
+	(map->values) = (int*)malloc(INITIAL_CAPACITY * sizeof(int));
+	for (int i = 0; i < INITIAL_CAPACITY; i++) {
+		(map->values)[i] = -1;
+	}
+	return map;
+}
+
+/**
+* Free the given PairMap.
+*/
+void PairMap_free(PairMap* map) {
+	free(map->keys);
+	free(map->values);
+	free(map);
+}
+
+/**
+* Return the number of entries in the given PairMap.
+*/
+int PairMap_size(const PairMap* map) {
+	return (map->size);
+}
+
+//Key of the pair (p, q), shifted so that -1 is stored as 0
+static uint64_t PairMap_key(int p, int q) {
+	return ((uint64_t)(uint32_t)(p + 1) << 32) | (uint32_t)(q + 1);
+}
+
+//Return the slot holding key, or the empty slot where it would be inserted
+static int PairMap_find_slot(const PairMap* map, uint64_t key) {
+	int mask = (map->capacity) - 1;
+	int slot = (int)((key * 0x9e3779b97f4a7c15ULL) >> 32) & mask;	//Top bits of the product mix both halves
+	while ((map->values)[slot] != -1 && (map->keys)[slot] != key) {
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+//Double the capacity of the table and reinsert every entry
+static void PairMap_grow(PairMap* map) {
+	int oldCapacity = (map->capacity);
+	uint64_t* oldKeys = (map->keys);
+	int* oldValues = (map->values);
+
+	(map->capacity) = 2 * oldCapacity;
+	(map->keys) = (uint64_t*)malloc((map->capacity) * sizeof(uint64_t));
+	(map->values) = (int*)malloc((map->capacity) * sizeof(int));
+	for (int i = 0; i < (map->capacity); i++) {
+		(map->values)[i] = -1;
+	}
+	for (int i = 0; i < oldCapacity; i++) {
+		if (oldValues[i] != -1) {
+			int slot = PairMap_find_slot(map, oldKeys[i]);
+			(map->keys)[slot] = oldKeys[i];
+			(map->values)[slot] = oldValues[i];
+		}
+	}
+	free(oldKeys);
+	free(oldValues);
+}
+
+/**
+* Return the value stored for the pair (p, q), or -1 if there is no such
+* entry.
+*/
+int PairMap_get(const PairMap* map, int p, int q) {
+	return (map->values)[PairMap_find_slot(map, PairMap_key(p, q))];
+}
+
+/**
+* Store value for the pair (p, q), replacing any previous value.
+*/
+void PairMap_put(PairMap* map, int p, int q, int value) {
+	if (2 * ((map->size) + 1) > (map->capacity)) {
+		PairMap_grow(map);
+	}
+	uint64_t key = PairMap_key(p, q);
+	int slot = PairMap_find_slot(map, key);
+	if ((map->values)[slot] == -1) {
+		(map->keys)[slot] = key;
+		(map->size) += 1;
+	}
+	(map->values)[slot] = value;
+}
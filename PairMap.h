@@ -0,0 +1,52 @@
+/*
+* Author: Peter Hess
+* File: PairMap.h
+*
+* Hash map from pairs of states to integer ids.
+* Used by the product construction and the equivalence checks to look up
+* pairs of states of two automata in expected O(1).
+*/
+
+#ifndef _PairMap_h
+#define _PairMap_h
+
+#include <stdint.h>
+
+/**
+* Open-addressed hash table keyed by pairs of ints, each at least -1 (for
+* HALT). Values must not be negative.
+*/
+typedef struct {
+	int capacity;		//Always a power of two
+	int size;
+	uint64_t* keys;
+	int* values;		//-1 marks an empty slot
+}PairMap;
+
+/**
+* Allocate and return a new, empty PairMap.
+*/
+extern PairMap* PairMap_new();
+
+/**
+* Free the given PairMap.
+*/
+extern void PairMap_free(PairMap* map);
+
+/**
+* Return the number of entries in the given PairMap.
+*/
+extern int PairMap_size(const PairMap* map);
+
+/**
+* Return the value stored for the pair (p, q), or -1 if there is no such
+* entry.
+*/
+extern int PairMap_get(const PairMap* map, int p, int q);
+
+/**
+* Store value for the pair (p, q), replacing any previous value.
+*/
+extern void PairMap_put(PairMap* map, int p, int q, int value);
+
+#endif
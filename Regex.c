@@ -0,0 +1,575 @@
+/*
+* Author: Peter Hess
+* File: Regex.c
+*
+* Regular expression compiler. A recursive descent parser builds a syntax
+* tree, counting the NFA states each subexpression will need, and the tree
+* is then turned into an NFA by Thompson's construction: each
+* subexpression becomes a fragment with one entry and one exit state,
+* joined to the others by epsilon moves.
+*
+* A set of symbols is a sorted list of disjoint ranges. Symbols are bytes,
+* or, for Regex_compile_utf8, Unicode codepoints; a range of codepoints is
+* split into ranges whose UTF-8 encodings differ only by a range of bytes
+* in each position, and each of those becomes a chain of byte transitions.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "nfa.h"
+#include "Regex.h"
+
+#define UTF8_MAX 0x10ffff				//Largest codepoint
+#define SURROGATE_FIRST 0xd800			//Codepoints reserved for UTF-16, which have no UTF-8 encoding
+#define SURROGATE_LAST 0xdfff
+
+typedef enum { SYMBOLS, EMPTY, CONCAT, ALT, STAR, PLUS, OPT } NodeType;
+
+//Inclusive range of symbols
+typedef struct {
+	int lo;
+	int hi;
+}Range;
+
+//Syntax tree node; children are indices into the parser's node array
+typedef struct {
+	NodeType type;
+	int left;
+	int right;
+	int first;						//For SYMBOLS: the symbols matched are ranges[first] to ranges[first + count - 1]
+	int count;
+	int states;						//NFA states needed by the subexpression
+}Node;
+
+typedef struct {
+	const char* pattern;
+	int pos;
+	bool utf8;						//Symbols are codepoints, read and matched as UTF-8
+	Node* nodes;
+	int size;
+	int capacity;
+	Range* ranges;					//Ranges of every SYMBOLS node, each node's together
+	int nranges;
+	int rangeCapacity;
+	const char* error;				//First error found, or NULL
+}Parser;
+
+static int Parser_node(Parser* p, NodeType type, int left, int right) {
+	if ((p->size) == (p->capacity)) {
+		(p->capacity) = (p->capacity) == 0 ? 64 : 2 * (p->capacity);
+		(p->nodes) = (Node*)realloc(p->nodes, (p->capacity) * sizeof(Node));
+	}
+	Node* node = &((p->nodes)[p->size]);
+	(node->type) = type;
+	(node->left) = left;
+	(node->right) = right;
+	(node->first) = (p->nranges);
+	(node->count) = 0;
+	switch (type) {
+	case SYMBOLS:
+		(node->states) = 2;
+		break;
+	case EMPTY:
+		(node->states) = 1;
+		break;
+	case CONCAT:
+		(node->states) = (p->nodes)[left].states + (p->nodes)[right].states;
+		break;
+	case ALT:
+		(node->states) = (p->nodes)[left].states + (p->nodes)[right].states + 2;
+		break;
+	default:
+		(node->states) = (p->nodes)[left].states + 2;
+		break;
+	}
+	return (p->size)++;
+}
+
+static void Parser_fail(Parser* p, const char* error) {
+	if ((p->error) == NULL) {
+		(p->error) = error;
+	}
+}
+
+static char Parser_peek(Parser* p) {
+	return (p->pattern)[p->pos];
+}
+
+//Value of the hex digit c, or -1
+static int Regex_hex(char c) {
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	}
+	if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	}
+	if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+//Decode the UTF-8 sequence at s, storing its length in *len; returns -1 if it is not the shortest encoding of a codepoint
+static int Regex_utf8_decode(const unsigned char* s, int* len) {
+	int n = (s[0] < 0x80) ? 1 : (s[0] >= 0xc2 && s[0] < 0xe0) ? 2 : (s[0] >= 0xe0 && s[0] < 0xf0) ? 3 : (s[0] >= 0xf0 && s[0] < 0xf5) ? 4 : 0;
+	if (n == 0) {
+		return -1;
+	}
+	int c = (n == 1) ? s[0] : s[0] & (0x7f >> n);
+	for (int i = 1; i < n; i++) {
+		if ((s[i] & 0xc0) != 0x80) {						//Also stops at the NUL that ends the pattern
+			return -1;
+		}
+		c = (c << 6) | (s[i] & 0x3f);
+	}
+	static const int least[5] = { 0, 0, 0x80, 0x800, 0x10000 };
+	if (c < least[n] || c > UTF8_MAX || (c >= SURROGATE_FIRST && c <= SURROGATE_LAST)) {
+		return -1;										//Overlong, too large, or a surrogate
+	}
+	*len = n;
+	return c;
+}
+
+//Read one symbol, following a backslash if there is one; returns -1 on error
+static int Parser_symbol(Parser* p) {
+	int c = (unsigned char)(p->pattern)[p->pos];
+	if (c == '\\') {
+		(p->pos)++;
+		c = (unsigned char)(p->pattern)[p->pos];
+		if (c == '\0') {
+			Parser_fail(p, "trailing backslash");
+			return -1;
+		}
+		if (c == 'n') {
+			(p->pos)++;
+			return '\n';
+		}
+		if (c == 't') {
+			(p->pos)++;
+			return '\t';
+		}
+		if (c == 'x') {									//\xhh: the byte, or in UTF-8 the codepoint, with that value
+			int hi = Regex_hex((p->pattern)[(p->pos) + 1]);
+			int lo = (hi < 0) ? -1 : Regex_hex((p->pattern)[(p->pos) + 2]);
+			if (lo < 0) {
+				Parser_fail(p, "\\x needs two hex digits");
+				return -1;
+			}
+			(p->pos) += 3;
+			return hi * 16 + lo;
+		}
+	}
+	if (!(p->utf8) || c < 0x80) {
+		(p->pos)++;
+		return c;
+	}
+	int len;
+	c = Regex_utf8_decode((const unsigned char*)(p->pattern) + (p->pos), &len);
+	if (c < 0) {
+		Parser_fail(p, "invalid UTF-8");
+		return -1;
+	}
+	(p->pos) += len;
+	return c;
+}
+
+//Append the range lo to hi to the ranges of the SYMBOLS node being parsed
+static void Parser_range(Parser* p, int lo, int hi) {
+	if ((p->nranges) == (p->rangeCapacity)) {
+		(p->rangeCapacity) = (p->rangeCapacity) == 0 ? 64 : 2 * (p->rangeCapacity);
+		(p->ranges) = (Range*)realloc(p->ranges, (p->rangeCapacity) * sizeof(Range));
+	}
+	(p->ranges)[p->nranges].lo = lo;
+	(p->ranges)[p->nranges].hi = hi;
+	(p->nranges)++;
+}
+
+static int Regex_compare_ranges(const void* a, const void* b) {
+	const Range* x = (const Range*)a;
+	const Range* y = (const Range*)b;
+	return ((x->lo) > (y->lo)) - ((x->lo) < (y->lo));
+}
+
+static void Regex_utf8_ranges(NFA* nfa, int lo, int hi, int in, int out, int* next);
+
+//Sort and merge the ranges of the given SYMBOLS node, the last ones appended, complement them
+//if negate is true, and count the states the node needs
+static void Parser_symbols(Parser* p, int node, bool negate) {
+	Node* n = &((p->nodes)[node]);
+	Range* r = (p->ranges) + (n->first);
+	int count = (p->nranges) - (n->first);
+	if (count > 1) {
+		qsort(r, count, sizeof(Range), Regex_compare_ranges);
+	}
+	int merged = 0;
+	for (int i = 0; i < count; i++) {
+		if (merged > 0 && r[i].lo <= r[merged - 1].hi + 1) {
+			if (r[i].hi > r[merged - 1].hi) {
+				r[merged - 1].hi = r[i].hi;
+			}
+		}
+		else {
+			r[merged++] = r[i];
+		}
+	}
+	(p->nranges) = (n->first) + merged;
+	if (negate) {										//The gaps between the ranges, and around them
+		int max = (p->utf8) ? UTF8_MAX : sigma - 1;
+		Range* gaps = (Range*)malloc((merged + 1) * sizeof(Range));
+		int ngaps = 0;
+		int from = 0;
+		for (int i = 0; i < merged; i++) {
+			if (r[i].lo > from) {
+				gaps[ngaps].lo = from;
+				gaps[ngaps++].hi = r[i].lo - 1;
+			}
+			from = r[i].hi + 1;
+		}
+		if (from <= max) {
+			gaps[ngaps].lo = from;
+			gaps[ngaps++].hi = max;
+		}
+		(p->nranges) = (n->first);
+		for (int i = 0; i < ngaps; i++) {
+			Parser_range(p, gaps[i].lo, gaps[i].hi);
+		}
+		free(gaps);
+		n = &((p->nodes)[node]);
+		merged = ngaps;
+	}
+	(n->count) = merged;
+	if ((p->utf8)) {									//Plus the inner states of each chain of bytes
+		int inner = 0;
+		for (int i = 0; i < merged; i++) {
+			Regex_utf8_ranges(NULL, (p->ranges)[(n->first) + i].lo, (p->ranges)[(n->first) + i].hi, 0, 0, &inner);
+		}
+		(n->states) += inner;
+	}
+}
+
+//Parse a character class; the opening '[' has been read
+static int Parser_class(Parser* p) {
+	int node = Parser_node(p, SYMBOLS, -1, -1);
+	bool negate = false;
+	if (Parser_peek(p) == '^') {
+		negate = true;
+		(p->pos)++;
+	}
+	bool first = true;
+	while (Parser_peek(p) != ']' || first) {		//A ']' right after the '[' is a symbol
+		if (Parser_peek(p) == '\0') {
+			Parser_fail(p, "missing ]");
+			return node;
+		}
+		first = false;
+		int lo = Parser_symbol(p);
+		int hi = lo;
+		if (Parser_peek(p) == '-' && (p->pattern)[(p->pos) + 1] != ']' && (p->pattern)[(p->pos) + 1] != '\0') {
+			(p->pos)++;
+			hi = Parser_symbol(p);
+		}
+		if (lo < 0 || hi < 0) {
+			return node;
+		}
+		if (hi < lo) {
+			Parser_fail(p, "range out of order in character class");
+			return node;
+		}
+		Parser_range(p, lo, hi);
+	}
+	(p->pos)++;
+	Parser_symbols(p, node, negate);
+	return node;
+}
+
+static int Parser_alternation(Parser* p);
+
+//atom := '(' alternation ')' | '[' class ']' | '.' | symbol
+static int Parser_atom(Parser* p) {
+	char c = Parser_peek(p);
+	if (c == '(') {
+		(p->pos)++;
+		int node = Parser_alternation(p);
+		if (Parser_peek(p) != ')') {
+			Parser_fail(p, "missing )");
+		}
+		else {
+			(p->pos)++;
+		}
+		return node;
+	}
+	if (c == '[') {
+		(p->pos)++;
+		return Parser_class(p);
+	}
+	if (c == '*' || c == '+' || c == '?') {
+		Parser_fail(p, "nothing to repeat");
+		(p->pos)++;
+		return Parser_node(p, EMPTY, -1, -1);
+	}
+	int node = Parser_node(p, SYMBOLS, -1, -1);
+	if (c == '.') {
+		(p->pos)++;
+		Parser_symbols(p, node, true);					//The complement of nothing
+	}
+	else {
+		int sym = Parser_symbol(p);
+		if (sym >= 0) {
+			Parser_range(p, sym, sym);
+		}
+		Parser_symbols(p, node, false);
+	}
+	return node;
+}
+
+//repeat := atom ('*' | '+' | '?')*
+static int Parser_repeat(Parser* p) {
+	int node = Parser_atom(p);
+	while (true) {
+		char c = Parser_peek(p);
+		if (c == '*') {
+			node = Parser_node(p, STAR, node, -1);
+		}
+		else if (c == '+') {
+			node = Parser_node(p, PLUS, node, -1);
+		}
+		else if (c == '?') {
+			node = Parser_node(p, OPT, node, -1);
+		}
+		else {
+			return node;
+		}
+		(p->pos)++;
+	}
+}
+
+//concatenation := repeat*
+static int Parser_concatenation(Parser* p) {
+	int node = -1;
+	while (Parser_peek(p) != '\0' && Parser_peek(p) != '|' && Parser_peek(p) != ')' && (p->error) == NULL) {
+		int next = Parser_repeat(p);
+		node = (node == -1) ? next : Parser_node(p, CONCAT, node, next);
+	}
+	return (node == -1) ? Parser_node(p, EMPTY, -1, -1) : node;
+}
+
+//alternation := concatenation ('|' concatenation)*
+static int Parser_alternation(Parser* p) {
+	int node = Parser_concatenation(p);
+	while (Parser_peek(p) == '|') {
+		(p->pos)++;
+		node = Parser_node(p, ALT, node, Parser_concatenation(p));
+	}
+	return node;
+}
+
+//Store the UTF-8 encoding of codepoint c in bytes, returning its length
+static int Regex_utf8_encode(int c, uint8_t* bytes) {
+	if (c < 0x80) {
+		bytes[0] = (uint8_t)c;
+		return 1;
+	}
+	int n = (c < 0x800) ? 2 : (c < 0x10000) ? 3 : 4;
+	for (int i = n - 1; i > 0; i--) {
+		bytes[i] = (uint8_t)(0x80 | (c & 0x3f));
+		c >>= 6;
+	}
+	bytes[0] = (uint8_t)(((0xff00 >> n) & 0xff) | c);	//n leading ones, then the top bits of c
+	return n;
+}
+
+//Add paths from state in to state out on the UTF-8 encodings of the codepoints lo to hi, numbering the states
+//inside them from *next on. With nfa NULL, only count those states in *next.
+static void Regex_utf8_ranges(NFA* nfa, int lo, int hi, int in, int out, int* next) {
+	static const int lastOfLength[3] = { 0x7f, 0x7ff, 0xffff };	//Largest codepoint of 1, 2 and 3 bytes
+	if (lo <= SURROGATE_LAST && hi >= SURROGATE_FIRST) {
+		if (lo < SURROGATE_FIRST) {
+			Regex_utf8_ranges(nfa, lo, SURROGATE_FIRST - 1, in, out, next);
+		}
+		if (hi > SURROGATE_LAST) {
+			Regex_utf8_ranges(nfa, SURROGATE_LAST + 1, hi, in, out, next);
+		}
+		return;
+	}
+	for (int i = 0; i < 3; i++) {						//Split where the encodings get longer
+		if (lo <= lastOfLength[i] && hi > lastOfLength[i]) {
+			Regex_utf8_ranges(nfa, lo, lastOfLength[i], in, out, next);
+			Regex_utf8_ranges(nfa, lastOfLength[i] + 1, hi, in, out, next);
+			return;
+		}
+	}
+	for (int i = 1; i < 4; i++) {						//Split until, for each i, lo and hi share all but their last i
+														//bytes, or those bytes span every continuation byte
+		int m = (1 << (6 * i)) - 1;
+		if ((lo & ~m) != (hi & ~m)) {
+			if ((lo & m) != 0) {
+				Regex_utf8_ranges(nfa, lo, lo | m, in, out, next);
+				Regex_utf8_ranges(nfa, (lo | m) + 1, hi, in, out, next);
+				return;
+			}
+			if ((hi & m) != m) {
+				Regex_utf8_ranges(nfa, lo, (hi & ~m) - 1, in, out, next);
+				Regex_utf8_ranges(nfa, hi & ~m, hi, in, out, next);
+				return;
+			}
+		}
+	}
+	uint8_t first[4];									//Now every encoding between is one byte from each range first[i] to last[i]
+	uint8_t last[4];
+	int n = Regex_utf8_encode(lo, first);
+	Regex_utf8_encode(hi, last);
+	int src = in;
+	for (int i = 0; i < n; i++) {
+		int dst = (i == n - 1) ? out : (*next)++;
+		if (nfa != NULL) {
+			NFA_add_transition_range(nfa, src, first[i], last[i], dst);
+		}
+		src = dst;
+	}
+}
+
+//Build the fragment for the given node from state *next on, storing its entry and exit states in entry and last
+static void Regex_build(NFA* nfa, const Parser* p, int node, int* next, int* entry, int* last) {
+	const Node* n = &((p->nodes)[node]);
+	int in, out, a, b, c, d;
+	switch (n->type) {
+	case SYMBOLS:
+		in = (*next)++;
+		out = (*next)++;
+		for (int i = 0; i < (n->count); i++) {			//One edge per range of bytes, or one chain of edges per range of their encodings
+			const Range* r = &((p->ranges)[(n->first) + i]);
+			if ((p->utf8)) {
+				Regex_utf8_ranges(nfa, r->lo, r->hi, in, out, next);
+			}
+			else {
+				NFA_add_transition_range(nfa, in, r->lo, r->hi, out);
+			}
+		}
+		break;
+	case EMPTY:
+		in = out = (*next)++;
+		break;
+	case CONCAT:
+		Regex_build(nfa, p, n->left, next, &in, &a);
+		Regex_build(nfa, p, n->right, next, &b, &out);
+		NFA_add_epsilon(nfa, a, b);
+		break;
+	case ALT:
+		in = (*next)++;
+		out = (*next)++;
+		Regex_build(nfa, p, n->left, next, &a, &b);
+		Regex_build(nfa, p, n->right, next, &c, &d);
+		NFA_add_epsilon(nfa, in, a);
+		NFA_add_epsilon(nfa, in, c);
+		NFA_add_epsilon(nfa, b, out);
+		NFA_add_epsilon(nfa, d, out);
+		break;
+	default:					//STAR, PLUS and OPT differ only in which of the two back and skip moves they have
+		in = (*next)++;
+		out = (*next)++;
+		Regex_build(nfa, p, n->left, next, &a, &b);
+		NFA_add_epsilon(nfa, in, a);
+		NFA_add_epsilon(nfa, b, out);
+		if (n->type != OPT) {
+			NFA_add_epsilon(nfa, b, a);
+		}
+		if (n->type != PLUS) {
+			NFA_add_epsilon(nfa, in, out);
+		}
+		break;
+	}
+	*entry = in;
+	*last = out;
+}
+
+//Compile the n patterns into one NFA, as Regex_compile_set, reading them as UTF-8 if utf8 is true
+static NFA* Regex_compile_patterns(const char* const* patterns, int n, bool utf8, const char** error) {
+	Parser p;
+	p.utf8 = utf8;
+	p.nodes = NULL;
+	p.size = 0;
+	p.capacity = 0;
+	p.ranges = NULL;
+	p.nranges = 0;
+	p.rangeCapacity = 0;
+	p.error = NULL;
+
+	int* roots = (int*)malloc((n + 1) * sizeof(int));
+	int nstates = 1;									//State 0 is the start state, leading into each root fragment
+	for (int i = 0; i < n && p.error == NULL; i++) {
+		p.pattern = patterns[i];
+		p.pos = 0;
+		roots[i] = Parser_alternation(&p);
+		if (p.error == NULL && Parser_peek(&p) != '\0') {	//Only a stray ')' stops the parse early
+			Parser_fail(&p, "unmatched )");
+		}
+		nstates += p.nodes[roots[i]].states;
+	}
+	if (p.error != NULL) {
+		if (error != NULL) {
+			*error = p.error;
+		}
+		free(p.nodes);
+		free(p.ranges);
+		free(roots);
+		return NULL;
+	}
+
+	NFA* nfa = NFA_new(nstates);
+	int next = 1;
+	for (int i = 0; i < n; i++) {
+		int entry, last;
+		Regex_build(nfa, &p, roots[i], &next, &entry, &last);
+		NFA_add_epsilon(nfa, 0, entry);
+		if (i == 0) {
+			NFA_set_accepting(nfa, last, true);			//Pattern 0 needs no ids, so a single pattern has none
+		}
+		else {
+			NFA_set_pattern(nfa, last, i);
+		}
+	}
+	NFA_close(nfa);
+	NFA_compress(nfa);
+	free(p.nodes);
+	free(p.ranges);
+	free(roots);
+	return nfa;
+}
+
+/**
+* Return a new NFA that accepts exactly the strings matched by the given
+* regular expression, or NULL if it is not well formed, in which case
+* *error (if error is not NULL) is set to a description of the problem.
+*/
+NFA* Regex_compile(const char* pattern, const char** error) {
+	return Regex_compile_patterns(&pattern, 1, false, error);
+}
+
+/**
+* Return a new NFA that accepts the strings matched by any of the n given
+* regular expressions, where the accepting state of patterns[i] reports
+* pattern id i; or NULL if any of them is not well formed.
+*/
+NFA* Regex_compile_set(const char* const* patterns, int n, const char** error) {
+	return Regex_compile_patterns(patterns, n, false, error);
+}
+
+/**
+* Return a new NFA that accepts the UTF-8 encodings of exactly the strings
+* of codepoints matched by the given regular expression, itself in UTF-8,
+* or NULL if it is not well formed or not valid UTF-8.
+*/
+NFA* Regex_compile_utf8(const char* pattern, const char** error) {
+	return Regex_compile_patterns(&pattern, 1, true, error);
+}
+
+/**
+* Return a new NFA that accepts the UTF-8 strings matched by any of the n
+* given regular expressions, as Regex_compile_set does for bytes; or NULL
+* if any of them is not well formed or not valid UTF-8.
+*/
+NFA* Regex_compile_set_utf8(const char* const* patterns, int n, const char** error) {
+	return Regex_compile_patterns(patterns, n, true, error);
+}
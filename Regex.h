@@ -0,0 +1,64 @@
+/*
+* Author: Peter Hess
+* File: Regex.h
+*
+* Regular expressions, compiled to NFAs by Thompson's construction. A
+* pattern's symbols are bytes, or, compiled with the _utf8 functions,
+* Unicode codepoints written and matched in UTF-8.
+*/
+
+#ifndef _Regex_h
+#define _Regex_h
+
+#include "nfa.h"
+
+/**
+* Return a new NFA that accepts exactly the strings matched by the given
+* regular expression, or NULL if it is not well formed, in which case
+* *error (if error is not NULL) is set to a description of the problem.
+* The syntax is:
+*	ab		concatenation
+*	a|b		alternation
+*	a* a+ a?	zero or more, one or more, zero or one
+*	(a)		grouping
+*	.		any symbol
+*	[abc] [a-z] [^a-z]	character classes, and their complements
+*	\c		the symbol c itself, for any special symbol c; \n and \t are
+*			newline and tab, and \xhh is the symbol of value hh in hex: a
+*			byte here, and the codepoint U+00hh for Regex_compile_utf8
+* The NFA has epsilon moves and is already closed by NFA_close, so it can
+* be run or given to subsetConstruct as it is.
+*/
+extern NFA* Regex_compile(const char* pattern, const char** error);
+
+/**
+* Return a new NFA that accepts the strings matched by any of the n given
+* regular expressions, where the accepting state of patterns[i] reports
+* pattern id i (see NFA_set_pattern); or NULL if any of them is not well
+* formed, in which case *error is set as for Regex_compile. Turning the
+* NFA into a DFA gives one automaton that finds every pattern in a single
+* pass with DFA_match_all.
+*/
+extern NFA* Regex_compile_set(const char* const* patterns, int n, const char** error);
+
+/**
+* Return a new NFA that accepts the UTF-8 encodings of exactly the strings
+* of codepoints matched by the given regular expression, itself in UTF-8,
+* or NULL if it is not well formed or not valid UTF-8; *error is set as
+* for Regex_compile. The syntax is the same, but each symbol is one
+* codepoint: . and [^...] match any one codepoint, and [a-z] any between
+* the two. The NFA reads one byte at a time, each range of codepoints
+* becoming chains of transitions on ranges of bytes, so it never accepts
+* invalid UTF-8, and after subsetConstruct its DFA runs on raw bytes at
+* the speed of any other.
+*/
+extern NFA* Regex_compile_utf8(const char* pattern, const char** error);
+
+/**
+* Return a new NFA that accepts the UTF-8 strings matched by any of the n
+* given regular expressions, as Regex_compile_set does for bytes; or NULL
+* if any of them is not well formed or not valid UTF-8.
+*/
+extern NFA* Regex_compile_set_utf8(const char* const* patterns, int n, const char** error);
+
+#endif
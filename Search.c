@@ -0,0 +1,266 @@
+/*
+* Author: Peter Hess
+* File: Search.c
+*
+* Unanchored search with two DFAs. The reverse DFA accepts the reverses of
+* strings that begin with a match, so one backwards pass over the text
+* marks every offset where a match starts. The leftmost match then starts
+* at the first marked offset, and the forward DFA, run anchored from
+* there, finds its end. Each byte is read once backwards. Forwards, a
+* shortest match reads only its own bytes, but a longest match reads on
+* for as long as a longer match is still possible, which for a pattern
+* like x.*y|x on a text of many x's and no y is the rest of the text, so
+* finding every match can take time quadratic in the length of the text.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "dfa.h"
+#include "nfa.h"
+#include "IntSet.h"
+#include "subset.h"
+#include "Search.h"
+
+#define HALT -1
+
+//Transition table of a DFA, widened to int so the search loops need no case per width
+typedef struct {
+	int nclasses;
+	uint8_t classes[sigma];
+	int* next;			//numStates by nclasses, HALT for no transition
+	bool* accept;
+	bool* live;			//True for the states that can reach an accepting state
+}Table;
+
+struct Search {
+	SearchKind kind;
+	Table forward;		//The NFA's language, from the start of a match
+	Table reverse;		//Reverses of strings that begin with a match
+};
+
+struct SearchIterator {
+	const Search* search;
+	const uint8_t* text;
+	size_t len;
+	uint64_t* starts;	//Bit i is set if a match starts at offset i, for i from 0 to len
+	size_t pos;			//Where the next match may start
+};
+
+static void Table_init(Table* table, const DFA* dfa) {
+	int n = DFA_get_size(dfa);
+	(table->nclasses) = (dfa->numClasses);
+	memcpy(table->classes, dfa->classes, sigma);
+	(table->next) = (int*)malloc(((size_t)n * (table->nclasses) + 1) * sizeof(int));
+	(table->accept) = (bool*)malloc((n + 1) * sizeof(bool));
+	for (int q = 0; q < n; q++) {
+		(table->accept)[q] = DFA_get_accepting(dfa, q);
+		for (int c = 0; c < (table->nclasses); c++) {
+			(table->next)[(size_t)q * (table->nclasses) + c] = DFA_get_class_transition(dfa, q, c);
+		}
+	}
+	if (n == 0) {									//An empty DFA accepts nothing
+		(table->accept)[0] = false;
+		for (int c = 0; c < (table->nclasses); c++) {
+			(table->next)[c] = HALT;
+		}
+	}
+
+	//A state is live if it accepts or has a transition to a live state; repeat until nothing changes
+	(table->live) = (bool*)malloc((n + 1) * sizeof(bool));
+	memcpy(table->live, table->accept, (n + 1) * sizeof(bool));
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (int q = n - 1; q >= 0; q--) {
+			for (int c = 0; c < (table->nclasses) && !(table->live)[q]; c++) {
+				int dst = (table->next)[(size_t)q * (table->nclasses) + c];
+				if (dst != HALT && (table->live)[dst]) {
+					(table->live)[q] = true;
+					changed = true;
+				}
+			}
+		}
+	}
+}
+
+static void Table_free(Table* table) {
+	free(table->next);
+	free(table->accept);
+	free(table->live);
+}
+
+/**
+* Allocate and return a new Search for the strings accepted by the given
+* NFA, which is not changed and is not needed once this returns.
+*/
+Search* Search_new(const NFA* nfa, SearchKind kind) {
+	Search* search = (Search*)malloc(sizeof(Search));
+	(search->kind) = kind;
+
+	DFA* dfa = subsetConstructMinimal(nfa);
+	Table_init(&(search->forward), dfa);
+	DFA_free(dfa);
+
+	NFA* rev = NFA_reverse(nfa);
+	NFA_add_transition_all(rev, 0, 0);				//A match may begin anywhere, so its reverse may be followed by anything
+	dfa = subsetConstructMinimal(rev);
+	Table_init(&(search->reverse), dfa);
+	DFA_free(dfa);
+	NFA_free(rev);
+	return search;
+}
+
+/**
+* Free the given Search.
+*/
+void Search_free(Search* search) {
+	Table_free(&(search->forward));
+	Table_free(&(search->reverse));
+	free(search);
+}
+
+//Set bit i of starts for every offset i from from to len at which a match of text starts
+static void Search_mark_starts(const Search* search, const uint8_t* text, size_t len, size_t from, uint64_t* starts) {
+	const Table* rev = &(search->reverse);
+	const int* next = (rev->next);
+	const uint8_t* classes = (rev->classes);
+	const bool* accept = (rev->accept);
+	size_t stride = (rev->nclasses);
+	int state = 0;
+	uint64_t word = accept[0] ? (uint64_t)1 << (len % 64) : 0;	//Bits of the word holding offset i; the empty string matches even at the end
+	for (size_t i = len; i-- > from;) {
+		if (i % 64 == 63) {							//Moved into a new word
+			starts[i / 64 + 1] |= word;
+			word = 0;
+		}
+		state = next[state * stride + classes[text[i]]];
+		if (state == HALT) {
+			state = 0;
+		}
+		word |= (uint64_t)accept[state] << (i % 64);
+	}
+	starts[from / 64] |= word;
+}
+
+//Return the first offset from from to len at which a match of text starts, or len + 1 if there is none
+static size_t Search_first_start(const Search* search, const uint8_t* text, size_t len, size_t from) {
+	const Table* rev = &(search->reverse);
+	const int* next = (rev->next);
+	const uint8_t* classes = (rev->classes);
+	const bool* accept = (rev->accept);
+	size_t stride = (rev->nclasses);
+	int state = 0;
+	size_t first = accept[0] ? len : len + 1;
+	for (size_t i = len; i-- > from;) {				//The same pass as Search_mark_starts, keeping only the last start seen
+		state = next[state * stride + classes[text[i]]];
+		if (state == HALT) {
+			state = 0;
+		}
+		if (accept[state]) {
+			first = i;
+		}
+	}
+	return first;
+}
+
+//Return the end of the match that starts at start, which must be the start of some match
+static size_t Search_match_end(const Search* search, const uint8_t* text, size_t len, size_t start) {
+	const Table* fwd = &(search->forward);
+	const int* next = (fwd->next);
+	const bool* live = (fwd->live);
+	size_t stride = (fwd->nclasses);
+	bool shortest = ((search->kind) == SEARCH_SHORTEST);
+	size_t end = start;								//Only stays unset if the start was wrong
+	int state = 0;
+	if ((fwd->accept)[0] && shortest) {
+		return start;
+	}
+	for (size_t i = start; i < len; i++) {
+		state = next[state * stride + (fwd->classes)[text[i]]];
+		if (state == HALT || !live[state]) {		//No longer match can follow
+			break;
+		}
+		if ((fwd->accept)[state]) {
+			end = i + 1;
+			if (shortest) {
+				break;
+			}
+		}
+	}
+	return end;
+}
+
+//Return the first offset from pos to len whose bit is set in starts, or len + 1 if there is none
+static size_t Search_next_start(const uint64_t* starts, size_t len, size_t pos) {
+	if (pos > len) {
+		return len + 1;
+	}
+	size_t w = pos / 64;
+	uint64_t bits = starts[w] & (~(uint64_t)0 << (pos % 64));
+	while (bits == 0) {
+		if (++w > len / 64) {
+			return len + 1;
+		}
+		bits = starts[w];
+	}
+	return w * 64 + IntSet_ctz(bits);
+}
+
+/**
+* Find the leftmost match of the given Search in len bytes of text that
+* starts at or after offset from, reading the text from len back to from.
+*/
+bool Search_find(const Search* search, const uint8_t* text, size_t len, size_t from, size_t* start, size_t* end) {
+	if (from > len) {
+		return false;
+	}
+	size_t first = Search_first_start(search, text, len, from);
+	if (first > len) {
+		return false;
+	}
+	*start = first;
+	*end = Search_match_end(search, text, len, first);
+	return true;
+}
+
+/**
+* Allocate and return an iterator over the non-overlapping matches of the
+* given Search in len bytes of text, from left to right.
+*/
+SearchIterator* Search_iterator(const Search* search, const uint8_t* text, size_t len) {
+	SearchIterator* iter = (SearchIterator*)malloc(sizeof(SearchIterator));
+	(iter->search) = search;
+	(iter->text) = text;
+	(iter->len) = len;
+	(iter->starts) = (uint64_t*)calloc(len / 64 + 1, sizeof(uint64_t));
+	(iter->pos) = 0;
+	Search_mark_starts(search, text, len, 0, iter->starts);
+	return iter;
+}
+
+/**
+* Free the given SearchIterator.
+*/
+void SearchIterator_free(SearchIterator* iter) {
+	free(iter->starts);
+	free(iter);
+}
+
+/**
+* Find the next match of the given iterator. Returns true and stores the
+* match's offsets in *start and *end, or returns false once there are no
+* more matches.
+*/
+bool SearchIterator_next(SearchIterator* iter, size_t* start, size_t* end) {
+	size_t first = Search_next_start(iter->starts, iter->len, iter->pos);
+	if (first > (iter->len)) {
+		(iter->pos) = (iter->len) + 1;
+		return false;
+	}
+	*start = first;
+	*end = Search_match_end(iter->search, iter->text, iter->len, first);
+	(iter->pos) = (*end > first) ? *end : first + 1;	//Step past an empty match so it is not found again
+	return true;
+}
@@ -0,0 +1,85 @@
+/*
+* Author: Peter Hess
+* File: Search.h
+*
+* Unanchored search: finding the matches of an automaton's language inside
+* a larger text, with their start and end offsets.
+*/
+
+#ifndef _Search_h
+#define _Search_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "nfa.h"
+
+/**
+* Which match to report when several start at the leftmost offset: the
+* one that ends last (POSIX leftmost-longest) or the one that ends first.
+* Finding the end of a longest match reads on until no longer match is
+* possible, so with patterns such as x.*y|x it may read to the end of the
+* text for every match, and iterating over all of them can take time
+* quadratic in the length of the text. Shortest matches read only their
+* own bytes.
+*/
+typedef enum { SEARCH_LONGEST, SEARCH_SHORTEST } SearchKind;
+
+/**
+* Compiled form of an NFA for searching: a forward DFA for the NFA's
+* language, which finds where a match ends, and a DFA for its reverse,
+* which finds where matches can start. A Search is not modified by
+* searching, so one Search may be used on many threads at once.
+*/
+typedef struct Search Search;
+
+/**
+* Iterator over the non-overlapping matches of a Search in one text.
+*/
+typedef struct SearchIterator SearchIterator;
+
+/**
+* Allocate and return a new Search for the strings accepted by the given
+* NFA, which is not changed and is not needed once this returns.
+*/
+extern Search* Search_new(const NFA* nfa, SearchKind kind);
+
+/**
+* Free the given Search.
+*/
+extern void Search_free(Search* search);
+
+/**
+* Find the leftmost match of the given Search in len bytes of text that
+* starts at or after offset from. Returns true and stores the match's
+* offsets in *start and *end (text[*start..*end) is the match), or
+* returns false if there is no match. Each call reads the text backwards
+* from len down to from, however near from the match is, so to walk
+* through the matches of a text use a SearchIterator, which reads it
+* backwards only once; calling this again from each match's end takes
+* time quadratic in the length of the text.
+*/
+extern bool Search_find(const Search* search, const uint8_t* text, size_t len, size_t from, size_t* start, size_t* end);
+
+/**
+* Allocate and return an iterator over the non-overlapping matches of the
+* given Search in len bytes of text, from left to right. The text is read
+* backwards once, here, to find every offset where a match can start; the
+* text must stay unchanged while the iterator is in use.
+*/
+extern SearchIterator* Search_iterator(const Search* search, const uint8_t* text, size_t len);
+
+/**
+* Free the given SearchIterator.
+*/
+extern void SearchIterator_free(SearchIterator* iter);
+
+/**
+* Find the next match of the given iterator. Returns true and stores the
+* match's offsets in *start and *end, or returns false once there are no
+* more matches. The next match starts where this one ended, or one byte
+* later if this match was empty.
+*/
+extern bool SearchIterator_next(SearchIterator* iter, size_t* start, size_t* end);
+
+#endif
@@ -0,0 +1,138 @@
+/*
+* Author: Peter Hess
+* File: SetMap.c
+*
+* Hash map from IntSets to integer ids, using open addressing with
+* linear probing. The table is kept at most half full.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "IntSet.h"
+#include "SetMap.h"
+
+#define INITIAL_CAPACITY 64
+
+/**
+* Allocate and return a new, empty SetMap.
+*/
+SetMap* SetMap_new() {
+	SetMap* map = (SetMap*)malloc(sizeof(SetMap));
+	(map->capacity) = INITIAL_CAPACITY;
+	(map->size) = 0;
+	(map->keys) = (IntSet**)calloc(INITIAL_CAPACITY, sizeof(IntSet*));	//NULL key marks an empty slot
+	(map->values) = (int*)malloc(INITIAL_CAPACITY * sizeof(int));
+	(map->hashes) = (uint64_t*)malloc(INITIAL_CAPACITY * sizeof(uint64_t));
+	return map;
+}
+
+/**
+* Free the given SetMap (but not the IntSets used as keys).
+*/
+void SetMap_free(SetMap* map) {
+	free(map->keys);
+	free(map->values);
+	free(map->hashes);
+	free(map);
+}
+
+/**
+* Return the number of entries in the given SetMap.
+*/
+int SetMap_size(SetMap* map) {
+	return (map->size);
+}
+
+//Return the slot holding set, or the empty slot where it would be inserted
+static int SetMap_find_slot(SetMap* map, IntSet* set, uint64_t hash) {
+	int mask = (map->capacity) - 1;
+	int slot = (int)(hash & mask);
+	while ((map->keys)[slot] != NULL) {
+		if ((map->hashes)[slot] == hash && IntSet_equals((map->keys)[slot], set)) {
+			return slot;
+		}
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+//Double the capacity of the table and reinsert every entry
+static void SetMap_grow(SetMap* map) {
+	int oldCapacity = (map->capacity);
+	IntSet** oldKeys = (map->keys);
+	int* oldValues = (map->values);
+	uint64_t* oldHashes = (map->hashes);
+
+	(map->capacity) = 2 * oldCapacity;
+	(map->keys) = (IntSet**)calloc(map->capacity, sizeof(IntSet*));
+	(map->values) = (int*)malloc((map->capacity) * sizeof(int));
+	(map->hashes) = (uint64_t*)malloc((map->capacity) * sizeof(uint64_t));
+
+	int mask = (map->capacity) - 1;
+	for (int i = 0; i < oldCapacity; i++) {
+		if (oldKeys[i] != NULL) {
+			int slot = (int)(oldHashes[i] & mask);		//Keys are distinct, so only need an empty slot
+			while ((map->keys)[slot] != NULL) {
+				slot = (slot + 1) & mask;
+			}
+			(map->keys)[slot] = oldKeys[i];
+			(map->values)[slot] = oldValues[i];
+			(map->hashes)[slot] = oldHashes[i];
+		}
+	}
+	free(oldKeys);
+	free(oldValues);
+	free(oldHashes);
+}
+
+/**
+* Return the value stored for a set equal to the given set, or -1 if
+* there is no such entry.
+*/
+int SetMap_get(SetMap* map, IntSet* set) {
+	return SetMap_get_hashed(map, set, IntSet_hash(set));
+}
+
+/**
+* Store value for the given set, replacing any previous value.
+*/
+void SetMap_put(SetMap* map, IntSet* set, int value) {
+	SetMap_put_hashed(map, set, IntSet_hash(set), value);
+}
+
+/**
+* As SetMap_get, for a set whose IntSet_hash is already known.
+*/
+int SetMap_get_hashed(SetMap* map, IntSet* set, uint64_t hash) {
+	int slot = SetMap_find_slot(map, set, hash);
+	if ((map->keys)[slot] == NULL) {
+		return -1;
+	}
+	return (map->values)[slot];
+}
+
+/**
+* As SetMap_put, for a set whose IntSet_hash is already known.
+*/
+void SetMap_put_hashed(SetMap* map, IntSet* set, uint64_t hash, int value) {
+	if (2 * ((map->size) + 1) > (map->capacity)) {
+		SetMap_grow(map);
+	}
+	int slot = SetMap_find_slot(map, set, hash);
+	if ((map->keys)[slot] == NULL) {
+		(map->keys)[slot] = set;
+		(map->hashes)[slot] = hash;
+		(map->size) += 1;
+	}
+	(map->values)[slot] = value;
+}
+
+/**
+* Remove every entry from the given SetMap, keeping its capacity.
+*/
+void SetMap_clear(SetMap* map) {
+	memset(map->keys, 0, (map->capacity) * sizeof(IntSet*));
+	(map->size) = 0;
+}
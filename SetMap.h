@@ -0,0 +1,70 @@
+/*
+* Author: Peter Hess
+* File: SetMap.h
+*
+* Hash map from IntSets (sets of NFA states) to integer ids.
+* Used by the subset construction to look up DFA states in expected O(1).
+*/
+
+#ifndef _SetMap_h
+#define _SetMap_h
+
+#include <stdbool.h>
+#include "IntSet.h"
+
+/**
+* Open-addressed hash table keyed by IntSet*. The map does not own its
+* keys; they must stay alive (and unmodified) while they are in the map.
+*/
+typedef struct {
+	int capacity;		//Always a power of two
+	int size;
+	IntSet** keys;
+	int* values;
+	uint64_t* hashes;
+}SetMap;
+
+/**
+* Allocate and return a new, empty SetMap.
+*/
+extern SetMap* SetMap_new();
+
+/**
+* Free the given SetMap (but not the IntSets used as keys).
+*/
+extern void SetMap_free(SetMap* map);
+
+/**
+* Return the number of entries in the given SetMap.
+*/
+extern int SetMap_size(SetMap* map);
+
+/**
+* Return the value stored for a set equal to the given set, or -1 if
+* there is no such entry.
+*/
+extern int SetMap_get(SetMap* map, IntSet* set);
+
+/**
+* Store value for the given set, replacing any previous value.
+*/
+extern void SetMap_put(SetMap* map, IntSet* set, int value);
+
+/**
+* As SetMap_get, for a set whose IntSet_hash is already known. Lookups
+* only read the map, so any number of threads may make them at once while
+* no thread changes the map.
+*/
+extern int SetMap_get_hashed(SetMap* map, IntSet* set, uint64_t hash);
+
+/**
+* As SetMap_put, for a set whose IntSet_hash is already known.
+*/
+extern void SetMap_put_hashed(SetMap* map, IntSet* set, uint64_t hash, int value);
+
+/**
+* Remove every entry from the given SetMap, keeping its capacity.
+*/
+extern void SetMap_clear(SetMap* map);
+
+#endif
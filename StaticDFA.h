@@ -0,0 +1,98 @@
+/*
+* Author: Peter Hess
+* File: StaticDFA.h
+*
+* DFAs fixed when the program is compiled: the transition table is a
+* static const array, written out in the source with designated
+* initializers or generated from a DFA by DFA_generate_static, so it lies
+* in read-only data and costs nothing at startup, and matching is an
+* inline loop the compiler can specialize to the table.
+*
+* A table has one row of 256 entries per state, one per byte, holding
+* STATIC_DFA_TO(next state), or 0 for no transition, so a row lists only
+* the transitions that exist:
+*
+*     static const uint8_t evenOnesTable[2][256] = {
+*         [0] = { ['0'] = STATIC_DFA_TO(0), ['1'] = STATIC_DFA_TO(1) },
+*         [1] = { ['0'] = STATIC_DFA_TO(1), ['1'] = STATIC_DFA_TO(0) },
+*     };
+*     static const bool evenOnesAccept[2] = { true, false };
+*     static const StaticDFA evenOnes = STATIC_DFA(evenOnesTable, evenOnesAccept);
+*/
+
+#ifndef _StaticDFA_h
+#define _StaticDFA_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "dfa.h"
+
+#define STATIC_DFA_MAX_STATES 255				//Most states of a StaticDFA, so that every entry fits a byte
+
+//Entry of a transition table for a transition to state
+#define STATIC_DFA_TO(state) ((uint8_t)((state) + 1))
+
+//Initializer of a StaticDFA from its table and accepting flags, arrays of one entry per state
+#define STATIC_DFA(table, accept) { (int)(sizeof(table) / sizeof((table)[0])), (table), (accept) }
+
+/**
+* A DFA whose start state is 0, with a transition table of one byte per
+* state and input byte, in the form described above.
+*/
+typedef struct {
+	int numStates;
+	const uint8_t (*table)[256];
+	const bool* accept;
+}StaticDFA;
+
+/**
+* Run the given StaticDFA on len bytes of input, and return true if it
+* accepts them, as DFA_feed and DFA_finish would.
+*/
+static __inline bool StaticDFA_match(const StaticDFA* dfa, const uint8_t* input, size_t len) {
+	int state = 0;
+	for (size_t i = 0; i < len; i++) {
+		state = (dfa->table)[state][input[i]] - 1;
+		if (state < 0) {
+			return false;							//Reject if no transition is available
+		}
+	}
+	return (dfa->accept)[state];
+}
+
+/**
+* Run the given StaticDFA on the given input string, and return true if
+* it accepts it, as DFA_execute would.
+*/
+static __inline bool StaticDFA_execute(const StaticDFA* dfa, const char* input) {
+	int state = 0;
+	for (const uint8_t* p = (const uint8_t*)input; *p != '\0'; p++) {
+		state = (dfa->table)[state][*p] - 1;
+		if (state < 0) {
+			return false;
+		}
+	}
+	return (dfa->accept)[state];
+}
+
+/**
+* Allocate and return a new DFA with the same states and transitions as
+* the given StaticDFA, for use with the functions on DFAs, its table
+* compressed into classes of symbols.
+*/
+static __inline DFA* StaticDFA_to_DFA(const StaticDFA* sdfa) {
+	DFA* dfa = DFA_new(sdfa->numStates);
+	for (int q = 0; q < (sdfa->numStates); q++) {
+		DFA_set_accepting(dfa, q, (sdfa->accept)[q]);
+		for (int sym = 0; sym < sigma; sym++) {
+			if ((sdfa->table)[q][sym] != 0) {
+				DFA_set_transition(dfa, q, (char)sym, (sdfa->table)[q][sym] - 1);
+			}
+		}
+	}
+	DFA_compress(dfa);
+	return dfa;
+}
+
+#endif
@@ -0,0 +1,135 @@
+/*
+* Author: Peter Hess
+* File: ThreadPool.c
+*
+* Fork-join thread pool on POSIX threads.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "ThreadPool.h"
+
+typedef struct {
+	ThreadPool* pool;
+	int index;
+}Worker;
+
+struct ThreadPool {
+	int nthreads;
+	pthread_t* threads;
+	Worker* workers;
+	pthread_mutex_t lock;
+	pthread_cond_t start;		//Signalled when a new task is posted
+	pthread_cond_t done;		//Signalled when the last worker finishes the task
+	unsigned long generation;	//Number of tasks posted so far
+	int running;				//Workers still running the current task
+	bool stop;
+	void(*task)(void* arg, int worker);
+	void* arg;
+};
+
+static void* ThreadPool_worker(void* data) {
+	Worker* self = (Worker*)data;
+	ThreadPool* pool = (self->pool);
+	unsigned long seen = 0;
+
+	pthread_mutex_lock(&(pool->lock));
+	while (true) {
+		while (!(pool->stop) && (pool->generation) == seen) {
+			pthread_cond_wait(&(pool->start), &(pool->lock));
+		}
+		if (pool->stop) {
+			break;
+		}
+		seen = (pool->generation);
+		void(*task)(void*, int) = (pool->task);
+		void* arg = (pool->arg);
+		pthread_mutex_unlock(&(pool->lock));
+
+		task(arg, self->index);
+
+		pthread_mutex_lock(&(pool->lock));
+		if (--(pool->running) == 0) {
+			pthread_cond_signal(&(pool->done));
+		}
+	}
+	pthread_mutex_unlock(&(pool->lock));
+	return NULL;
+}
+
+/**
+* Allocate and return a new ThreadPool of the given number of workers.
+* If nthreads is 0 or less, one worker per online processor is used.
+*/
+ThreadPool* ThreadPool_new(int nthreads) {
+	if (nthreads <= 0) {
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = (n > 0) ? (int)n : 1;
+	}
+	ThreadPool* pool = (ThreadPool*)malloc(sizeof(ThreadPool));
+	(pool->nthreads) = nthreads;
+	(pool->threads) = (pthread_t*)malloc(nthreads * sizeof(pthread_t));
+	(pool->workers) = (Worker*)malloc(nthreads * sizeof(Worker));
+	pthread_mutex_init(&(pool->lock), NULL);
+	pthread_cond_init(&(pool->start), NULL);
+	pthread_cond_init(&(pool->done), NULL);
+	(pool->generation) = 0;
+	(pool->running) = 0;
+	(pool->stop) = false;
+
+	for (int i = 0; i < nthreads; i++) {
+		(pool->workers)[i].pool = pool;
+		(pool->workers)[i].index = i;
+		if (pthread_create(&((pool->threads)[i]), NULL, ThreadPool_worker, &((pool->workers)[i])) != 0) {
+			fprintf(stderr, "ThreadPool_new: cannot create thread %d\n", i);
+			abort();
+		}
+	}
+	return pool;
+}
+
+/**
+* Stop the workers and free the given ThreadPool.
+*/
+void ThreadPool_free(ThreadPool* pool) {
+	pthread_mutex_lock(&(pool->lock));
+	(pool->stop) = true;
+	pthread_cond_broadcast(&(pool->start));
+	pthread_mutex_unlock(&(pool->lock));
+	for (int i = 0; i < (pool->nthreads); i++) {
+		pthread_join((pool->threads)[i], NULL);
+	}
+	pthread_mutex_destroy(&(pool->lock));
+	pthread_cond_destroy(&(pool->start));
+	pthread_cond_destroy(&(pool->done));
+	free(pool->threads);
+	free(pool->workers);
+	free(pool);
+}
+
+/**
+* Return the number of workers in the given ThreadPool.
+*/
+int ThreadPool_size(ThreadPool* pool) {
+	return (pool->nthreads);
+}
+
+/**
+* Call task(arg, worker) once on each worker, where worker runs from 0 to
+* ThreadPool_size(pool)-1, and return when every call has returned.
+*/
+void ThreadPool_run(ThreadPool* pool, void(*task)(void* arg, int worker), void* arg) {
+	pthread_mutex_lock(&(pool->lock));
+	(pool->task) = task;
+	(pool->arg) = arg;
+	(pool->running) = (pool->nthreads);
+	(pool->generation) += 1;
+	pthread_cond_broadcast(&(pool->start));
+	while ((pool->running) > 0) {
+		pthread_cond_wait(&(pool->done), &(pool->lock));
+	}
+	pthread_mutex_unlock(&(pool->lock));
+}
@@ -0,0 +1,37 @@
+/*
+* Author: Peter Hess
+* File: ThreadPool.h
+*
+* A fixed set of worker threads that run one task at a time, fork-join
+* style: every worker runs the task and the caller waits for all of them.
+*/
+
+#ifndef _ThreadPool_h
+#define _ThreadPool_h
+
+typedef struct ThreadPool ThreadPool;
+
+/**
+* Allocate and return a new ThreadPool of the given number of workers.
+* If nthreads is 0 or less, one worker per online processor is used.
+*/
+extern ThreadPool* ThreadPool_new(int nthreads);
+
+/**
+* Stop the workers and free the given ThreadPool.
+*/
+extern void ThreadPool_free(ThreadPool* pool);
+
+/**
+* Return the number of workers in the given ThreadPool.
+*/
+extern int ThreadPool_size(ThreadPool* pool);
+
+/**
+* Call task(arg, worker) once on each worker, where worker runs from 0 to
+* ThreadPool_size(pool)-1, and return when every call has returned.
+* Tasks divide the work among themselves, e.g. with an atomic counter.
+*/
+extern void ThreadPool_run(ThreadPool* pool, void(*task)(void* arg, int worker), void* arg);
+
+#endif
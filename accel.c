@@ -0,0 +1,170 @@
+/*
+* Author: Peter Hess
+* File: accel.c
+*
+* Byte search kernels for accelerated DFA states. With at most three escape
+* bytes each block of input is compared against each of them; with more,
+* each byte's two nibbles select bucket masks with a byte shuffle
+* ("shufti"), and the byte escapes if the masks share a bucket. Escape
+* bytes are bucketed by the low three bits of their high nibble, with one
+* low nibble table for each half of the byte range, picked by the top bit
+* as the shuffle zeroes lanes whose index has it set ("truffle"), so the
+* test is exact. The
+* AVX2 kernels are used when compiled with -mavx2, SSSE3 shuffles with
+* -mssse3, and SSE2 comparisons on any x86-64; elsewhere a scalar loop
+* over the stay bitmap is used.
+*/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "IntSet.h"
+#include "accel.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+/**
+* Set up the given Accel for a state that is left by exactly the bytes b
+* for which escapes[b] is true.
+*/
+void Accel_init(Accel* accel, const bool* escapes) {
+	memset(accel, 0, sizeof(Accel));
+	for (int b = 0; b < 256; b++) {
+		if (escapes[b]) {
+			if ((accel->nbytes) < ACCEL_MAX_BYTES) {
+				(accel->bytes)[accel->nbytes] = (uint8_t)b;
+			}
+			(accel->nbytes)++;
+			if (b < 128) {
+				(accel->lo)[b & 15] |= (uint8_t)(1 << ((b >> 4) & 7));	//One bucket per high nibble of each half
+			}
+			else {
+				(accel->loHigh)[b & 15] |= (uint8_t)(1 << ((b >> 4) & 7));
+			}
+		}
+		else {
+			(accel->stay)[b / 64] |= (uint64_t)1 << (b % 64);
+		}
+	}
+	for (int h = 0; h < 16; h++) {
+		(accel->hi)[h] = (uint8_t)(1 << (h & 7));
+	}
+	for (int i = (accel->nbytes); i < ACCEL_MAX_BYTES; i++) {		//Repeat a byte so every comparison is meaningful
+		(accel->bytes)[i] = (accel->bytes)[0];
+	}
+}
+
+//Scalar search, for the tail of the input and for machines without SIMD
+static size_t Accel_skip_scalar(const Accel* accel, const uint8_t* input, size_t len) {
+	size_t i = 0;
+	while (i < len && ((accel->stay)[input[i] >> 6] >> (input[i] & 63)) & 1) {
+		i++;
+	}
+	return i;
+}
+
+#if defined(__AVX2__)
+
+static size_t Accel_skip_simd(const Accel* accel, const uint8_t* input, size_t len) {
+	size_t i = 0;
+	if ((accel->nbytes) <= ACCEL_MAX_BYTES) {
+		__m256i b0 = _mm256_set1_epi8((char)(accel->bytes)[0]);
+		__m256i b1 = _mm256_set1_epi8((char)(accel->bytes)[1]);
+		__m256i b2 = _mm256_set1_epi8((char)(accel->bytes)[2]);
+		for (; i + 32 <= len; i += 32) {
+			__m256i v = _mm256_loadu_si256((const __m256i*)(input + i));
+			__m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, b0), _mm256_cmpeq_epi8(v, b1)),
+				_mm256_cmpeq_epi8(v, b2));
+			uint32_t mask = (uint32_t)_mm256_movemask_epi8(m);
+			if (mask != 0) {
+				return i + IntSet_ctz(mask);
+			}
+		}
+	}
+	else {
+		__m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(accel->lo)));
+		__m256i loHigh = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(accel->loHigh)));
+		__m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(accel->hi)));
+		__m256i nibble = _mm256_set1_epi8(0x0f);
+		__m256i top = _mm256_set1_epi8((char)0x80);
+		__m256i zero = _mm256_setzero_si256();
+		for (; i + 32 <= len; i += 32) {
+			__m256i v = _mm256_loadu_si256((const __m256i*)(input + i));
+			__m256i low = _mm256_or_si256(_mm256_shuffle_epi8(lo, v),			//Each shuffle zeroes the other half's lanes
+				_mm256_shuffle_epi8(loHigh, _mm256_xor_si256(v, top)));
+			__m256i t = _mm256_and_si256(low, _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+			uint32_t stay = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(t, zero));
+			if (stay != UINT32_MAX) {
+				return i + IntSet_ctz(~stay);
+			}
+		}
+	}
+	return i + Accel_skip_scalar(accel, input + i, len - i);
+}
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+static size_t Accel_skip_simd(const Accel* accel, const uint8_t* input, size_t len) {
+	size_t i = 0;
+	if ((accel->nbytes) <= ACCEL_MAX_BYTES) {
+		__m128i b0 = _mm_set1_epi8((char)(accel->bytes)[0]);
+		__m128i b1 = _mm_set1_epi8((char)(accel->bytes)[1]);
+		__m128i b2 = _mm_set1_epi8((char)(accel->bytes)[2]);
+		for (; i + 16 <= len; i += 16) {
+			__m128i v = _mm_loadu_si128((const __m128i*)(input + i));
+			__m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, b0), _mm_cmpeq_epi8(v, b1)),
+				_mm_cmpeq_epi8(v, b2));
+			int mask = _mm_movemask_epi8(m);
+			if (mask != 0) {
+				return i + IntSet_ctz((uint64_t)mask);
+			}
+		}
+	}
+#if defined(__SSSE3__)
+	else {
+		__m128i lo = _mm_loadu_si128((const __m128i*)(accel->lo));
+		__m128i loHigh = _mm_loadu_si128((const __m128i*)(accel->loHigh));
+		__m128i hi = _mm_loadu_si128((const __m128i*)(accel->hi));
+		__m128i nibble = _mm_set1_epi8(0x0f);
+		__m128i top = _mm_set1_epi8((char)0x80);
+		__m128i zero = _mm_setzero_si128();
+		for (; i + 16 <= len; i += 16) {
+			__m128i v = _mm_loadu_si128((const __m128i*)(input + i));
+			__m128i low = _mm_or_si128(_mm_shuffle_epi8(lo, v),				//Each shuffle zeroes the other half's lanes
+				_mm_shuffle_epi8(loHigh, _mm_xor_si128(v, top)));
+			__m128i t = _mm_and_si128(low, _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(v, 4), nibble)));
+			int stay = _mm_movemask_epi8(_mm_cmpeq_epi8(t, zero));
+			if (stay != 0xffff) {
+				return i + IntSet_ctz((uint64_t)(~stay & 0xffff));
+			}
+		}
+	}
+#endif
+	return i + Accel_skip_scalar(accel, input + i, len - i);
+}
+
+#else
+
+static size_t Accel_skip_simd(const Accel* accel, const uint8_t* input, size_t len) {
+	return Accel_skip_scalar(accel, input, len);
+}
+
+#endif
+
+/**
+* Return the number of leading bytes of input, of len bytes, that do not
+* leave the state described by accel (so len if none of them do).
+*/
+size_t Accel_skip(const Accel* accel, const uint8_t* input, size_t len) {
+	if ((accel->nbytes) == 0) {
+		return len;									//A state left by no byte is never left
+	}
+	return Accel_skip_simd(accel, input, len);
+}
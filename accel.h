@@ -0,0 +1,43 @@
+/*
+* Author: Peter Hess
+* File: accel.h
+*
+* Acceleration of DFA states that loop back to themselves on most symbols:
+* rather than take the self-loop one byte at a time, the scanner searches
+* for the next byte that leaves the state, 16 or 32 bytes at a time.
+*/
+
+#ifndef _accel_h
+#define _accel_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define ACCEL_MAX_BYTES 3		//Most escape bytes searched for by direct comparison
+
+/**
+* How to find the next byte that leaves a state.
+*/
+typedef struct {
+	int nbytes;					//Number of escape bytes; at most ACCEL_MAX_BYTES are compared directly
+	uint8_t bytes[ACCEL_MAX_BYTES];
+	uint8_t lo[16];				//Otherwise, escape bytes by nibble: byte b < 128 escapes if lo[b & 15] & hi[b >> 4],
+	uint8_t loHigh[16];			//and byte b >= 128 if loHigh[b & 15] & hi[b >> 4]
+	uint8_t hi[16];
+	uint64_t stay[4];			//Bit b is set if byte b does not leave the state, for the scalar path
+}Accel;
+
+/**
+* Set up the given Accel for a state that is left by exactly the bytes b
+* for which escapes[b] is true.
+*/
+extern void Accel_init(Accel* accel, const bool* escapes);
+
+/**
+* Return the number of leading bytes of input, of len bytes, that do not
+* leave the state described by accel (so len if none of them do).
+*/
+extern size_t Accel_skip(const Accel* accel, const uint8_t* input, size_t len);
+
+#endif
@@ -0,0 +1,143 @@
+/*
+* Author: Peter Hess
+* File: batch.c
+*
+* Matching large batches of inputs against one DFA on many threads.
+* Workers claim blocks of inputs from a shared atomic counter. A block is
+* a whole number of 64-input words of the result bitmap, so no two workers
+* ever write the same word.
+*
+* Within a block, inputs are run BATCH_LANES at a time in lockstep: each
+* step takes one byte from every lane before any lane takes its next. The
+* table lookups of different lanes do not depend on each other, so their
+* cache misses overlap instead of being paid one after another. A lane
+* whose input ends is refilled with the next input at once.
+*/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "dfa.h"
+#include "ThreadPool.h"
+#include "batch.h"
+
+#define WORDS_PER_BLOCK 16			//1024 inputs per claim keeps the counter off the hot path
+#define HALT -1
+
+typedef struct {
+	const DFA* dfa;
+	const char* const* inputs;
+	size_t n;
+	uint64_t* accepted;
+	atomic_size_t next;				//Next unclaimed word of accepted
+}BatchJob;
+
+//Run the DFA on inputs first to last - 1, BATCH_LANES at a time, setting the bits of accepted inputs.
+//The bits of those inputs must already be clear.
+#define DFA_INTERLEAVE(type, halt)										\
+	static void DFA_interleave_##type(const DFA* dfa, const char* const* inputs, size_t first, size_t last, uint64_t* accepted) {	\
+		const type* table = (const type*)(dfa->tTable);					\
+		const uint8_t* classes = (dfa->classes);						\
+		size_t stride = (dfa->numClasses);								\
+		const uint8_t* pos[BATCH_LANES];	/*Next byte of each lane's input*/	\
+		type state[BATCH_LANES];										\
+		size_t index[BATCH_LANES];			/*Which input each lane is running*/	\
+		int live = 0;						/*Lanes 0 to live - 1 are running*/	\
+		size_t next = first;											\
+		while (live < BATCH_LANES && next < last) {						\
+			pos[live] = (const uint8_t*)inputs[next];					\
+			state[live] = 0;											\
+			index[live++] = next++;										\
+		}																\
+		while (live > 0) {												\
+			for (int l = 0; l < live; l++) {							\
+				uint8_t c = *pos[l];									\
+				type q = (c != '\0') ? table[state[l] * stride + classes[c]] : (type)halt;	\
+				if (q != halt) {										\
+					state[l] = q;										\
+					pos[l]++;											\
+					continue;											\
+				}														\
+				if (c == '\0' && (dfa->accept)[state[l]]) {			\
+					accepted[index[l] / 64] |= 1ULL << (index[l] & 63);	\
+				}														\
+				if (next < last) {			/*Refill the lane*/		\
+					pos[l] = (const uint8_t*)inputs[next];				\
+					state[l] = 0;										\
+					index[l] = next++;									\
+				}														\
+				else {						/*Move the last live lane here*/	\
+					live--;												\
+					pos[l] = pos[live];									\
+					state[l] = state[live];								\
+					index[l] = index[live];								\
+					l--;												\
+				}														\
+			}															\
+		}																\
+	}
+
+DFA_INTERLEAVE(uint8_t, UINT8_MAX)
+DFA_INTERLEAVE(uint16_t, UINT16_MAX)
+DFA_INTERLEAVE(int32_t, HALT)
+
+//Run the DFA on inputs first to last - 1, which cover whole words of accepted, and store their results
+static void DFA_interleave(const DFA* dfa, const char* const* inputs, size_t first, size_t last, uint64_t* accepted) {
+	for (size_t w = first / 64; w < (last + 63) / 64; w++) {
+		accepted[w] = 0;
+	}
+	if ((dfa->numStates) == 0) {
+		return;
+	}
+	switch (dfa->width) {
+	case 1:
+		DFA_interleave_uint8_t(dfa, inputs, first, last, accepted);
+		break;
+	case 2:
+		DFA_interleave_uint16_t(dfa, inputs, first, last, accepted);
+		break;
+	default:
+		DFA_interleave_int32_t(dfa, inputs, first, last, accepted);
+		break;
+	}
+}
+
+static void DFA_batch_task(void* arg, int worker) {
+	BatchJob* job = (BatchJob*)arg;
+	size_t nwords = ((job->n) + 63) / 64;
+	(void)worker;
+
+	while (true) {
+		size_t first = atomic_fetch_add(&(job->next), WORDS_PER_BLOCK);
+		if (first >= nwords) {
+			break;
+		}
+		size_t last = (first + WORDS_PER_BLOCK < nwords) ? first + WORDS_PER_BLOCK : nwords;
+		DFA_interleave(job->dfa, job->inputs, 64 * first, (64 * last < (job->n)) ? 64 * last : (job->n), job->accepted);
+	}
+}
+
+/**
+* Run the given DFA on each of the n NUL-terminated inputs, spreading them
+* over the workers of pool, and record the results in accepted: bit i%64
+* of word i/64 is set iff inputs[i] is accepted.
+*/
+void DFA_execute_batch(const DFA* dfa, const char* const* inputs, size_t n, ThreadPool* pool, uint64_t* accepted) {
+	BatchJob job;
+	job.dfa = dfa;
+	job.inputs = inputs;
+	job.n = n;
+	job.accepted = accepted;
+	atomic_init(&(job.next), 0);
+	ThreadPool_run(pool, DFA_batch_task, &job);
+}
+
+/**
+* Run the given DFA on each of the n NUL-terminated inputs on the calling
+* thread, BATCH_LANES inputs at a time in lockstep, and record the results
+* in accepted as for DFA_execute_batch.
+*/
+void DFA_execute_interleaved(const DFA* dfa, const char* const* inputs, size_t n, uint64_t* accepted) {
+	DFA_interleave(dfa, inputs, 0, n, accepted);
+}
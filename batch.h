@@ -0,0 +1,37 @@
+/*
+* Author: Peter Hess
+* File: batch.h
+*
+* Matching large batches of inputs against one DFA on many threads.
+*/
+
+#ifndef _batch_h
+#define _batch_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include "dfa.h"
+#include "ThreadPool.h"
+
+// Number of inputs advanced together through the DFA by each thread
+#define BATCH_LANES 8
+
+/**
+* Run the given DFA on each of the n NUL-terminated inputs, spreading them
+* over the workers of pool, and record the results in accepted: bit i%64
+* of word i/64 is set iff inputs[i] is accepted. accepted must have room
+* for (n+63)/64 words. The DFA is shared by all workers, not copied.
+*/
+extern void DFA_execute_batch(const DFA* dfa, const char* const* inputs, size_t n, ThreadPool* pool, uint64_t* accepted);
+
+/**
+* Run the given DFA on each of the n NUL-terminated inputs on the calling
+* thread, and record the results in accepted as for DFA_execute_batch.
+* BATCH_LANES inputs are advanced together, one byte from each in turn,
+* so that the table lookups of different inputs overlap in memory rather
+* than each waiting for the last. This helps most with short inputs and
+* DFAs whose tables do not fit in cache.
+*/
+extern void DFA_execute_interleaved(const DFA* dfa, const char* const* inputs, size_t n, uint64_t* accepted);
+
+#endif
@@ -0,0 +1,1429 @@
+/*
+* Author: Peter Hess
+* File: bench.c
+*
+* Benchmarks for the automata library. Run with --report for a machine-readable
+* regression report (see main).
+* Build with: gcc -O2 -o bench bench.c codegen.c serialize.c accel.c Search.c Regex.c LazyDFA.c batch.c ThreadPool.c subset.c product.c equiv.c PairMap.c minimize.c SetMap.c ByteClass.c dfa.c nfa.c BitNFA.c IntSet.c Arena.c -pthread
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "dfa.h"
+#include "nfa.h"
+#include "IntSet.h"
+#include "Arena.h"
+#include "ByteClass.h"
+#include "subset.h"
+#include "minimize.h"
+#include "ThreadPool.h"
+#include "batch.h"
+#include "LazyDFA.h"
+#include "Regex.h"
+#include "Search.h"
+#include "serialize.h"
+#include "BitNFA.h"
+#include "product.h"
+#include "equiv.h"
+#include "StaticDFA.h"
+#include "codegen.h"
+
+#define HALT -1
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//NFA accepting binary strings whose k-th symbol from the end is '1'; its DFA has 2^k states
+static NFA* kthFromLast(int k) {
+	NFA* nfa = NFA_new(k + 1);
+	NFA_add_transition_all(nfa, 0, 0);
+	NFA_add_transition(nfa, 0, '1', 1);
+	for (int i = 1; i < k; i++) {
+		NFA_add_transition_str(nfa, i, "01", i + 1);
+	}
+	NFA_set_accepting(nfa, k, true);
+	return nfa;
+}
+
+//NFA accepting strings that end in a pseudo-random lowercase literal of length n-1
+static NFA* endsWithLiteral(int n, unsigned seed) {
+	NFA* nfa = NFA_new(n);
+	NFA_add_transition_all(nfa, 0, 0);
+	for (int i = 0; i < n - 1; i++) {
+		seed = seed * 1103515245 + 12345;
+		NFA_add_transition(nfa, i, (char)('a' + (seed >> 16) % 26), i + 1);
+	}
+	NFA_set_accepting(nfa, n - 1, true);
+	return nfa;
+}
+
+//Same NFA as endInMAN in Auto.c
+static NFA* endInMANNFA() {
+	NFA* nfa = NFA_new(4);
+	NFA_add_transition_all(nfa, 0, 0);
+	NFA_add_transition(nfa, 0, 'm', 1);
+	NFA_add_transition(nfa, 1, 'a', 2);
+	NFA_add_transition(nfa, 2, 'n', 3);
+	NFA_set_accepting(nfa, 3, true);
+	return nfa;
+}
+
+//Same NFA as xyz in Auto.c
+static NFA* xyzNFA() {
+	NFA* nfa = NFA_new(4);
+	for (int i = 0; i < 128; i++) {
+		if ((char)i != 'x' && (char)i != 'y' && (char)i != 'z') {
+			NFA_add_transition(nfa, 0, (char)i, 2);
+		}
+	}
+	NFA_add_transition_str(nfa, 0, "xyz", 1);
+	NFA_add_transition_str(nfa, 2, "xyz", 3);
+	NFA_add_transition_all(nfa, 2, 2);
+	NFA_set_accepting(nfa, 3, true);
+	return nfa;
+}
+
+//Same NFA as washington in Auto.c
+static NFA* washingtonNFA() {
+	NFA* nfa = NFA_new(12);
+	for (int i = 0; i < 12; i++) {
+		NFA_add_transition_all(nfa, i, i);
+	}
+	char * str = "aghiostw";
+	for (int i = 0; str[i] != '\0'; i++) {
+		NFA_add_transition(nfa, 0, str[i], i+1);
+		NFA_add_transition(nfa, i+1, str[i], 9);
+	}
+	NFA_add_transition(nfa, 0, 'n', 10);
+	NFA_add_transition(nfa, 10, 'n', 11);
+	NFA_add_transition(nfa, 11, 'n', 9);
+	NFA_set_accepting(nfa, 9, true);
+	return nfa;
+}
+
+//Generalization of washington: accepts strings in which one of the first n lowercase letters occurs twice
+static NFA* repeatedLetter(int n) {
+	NFA* nfa = NFA_new(n + 2);
+	for (int i = 0; i < n + 2; i++) {
+		NFA_add_transition_all(nfa, i, i);
+	}
+	for (int i = 0; i < n; i++) {
+		NFA_add_transition(nfa, 0, (char)('a' + i), i + 1);
+		NFA_add_transition(nfa, i + 1, (char)('a' + i), n + 1);
+	}
+	NFA_set_accepting(nfa, n + 1, true);
+	return nfa;
+}
+
+//NFA with n states and three random transitions per state over {a,b,c}; about a quarter of the states accept
+static NFA* randomNFA(int n, unsigned seed) {
+	NFA* nfa = NFA_new(n);
+	NFA_add_transition_all(nfa, 0, 0);
+	for (int i = 0; i < n; i++) {
+		for (int j = 0; j < 3; j++) {
+			seed = seed * 1103515245 + 12345;
+			int dst = (seed >> 16) % n;
+			seed = seed * 1103515245 + 12345;
+			NFA_add_transition(nfa, i, "abc"[(seed >> 16) % 3], dst);
+		}
+		seed = seed * 1103515245 + 12345;
+		NFA_set_accepting(nfa, i, (seed >> 16) % 4 == 0);
+	}
+	return nfa;
+}
+
+/*
+* Reference subset construction with the original list-based state lookup:
+* every new subset is compared against each state found so far, and the
+* work queue head is reached by walking the list. Successors are taken on
+* one symbol of each of the NFA's classes, as subsetConstruct does, so
+* that the comparison measures only the lookup of states.
+*/
+typedef struct listState {
+	IntSet* val;
+	int i;
+	struct listState* next;
+}listState;
+
+static int subsetConstructList(NFA* nfa) {
+	uint8_t classes[sigma];
+	int reps[sigma];
+	int nclasses = NFA_get_classes(nfa, classes);
+	ByteClass_representatives(classes, nclasses, reps);
+	listState* first = (listState*)malloc(sizeof(listState));
+	(first->val) = IntSet_new(nfa->numStates);
+	IntSet_add(first->val, 0);
+	(first->i) = 0;
+	(first->next) = NULL;
+	listState* last = first;
+	int numStates = 1;
+
+	for (int currIndex = 0; currIndex < numStates; currIndex++) {
+		listState* curr = first;
+		for (int i = 0; i < currIndex; i++) {		//LinkedList_element_at
+			curr = (curr->next);
+		}
+		for (int c = 0; c < nclasses; c++) {
+			IntSet* dst = IntSet_new(nfa->numStates);
+			IntSetIterator* iter = IntSet_iterator(curr->val);
+			while (IntSetIterator_has_next(iter)) {
+				NFA_get_transitions(nfa, IntSetIterator_next(iter), (char)reps[c], dst);
+			}
+			free(iter);
+			if (IntSet_is_empty(dst)) {
+				IntSet_free(dst);
+				continue;
+			}
+			bool isContained = false;
+			for (listState* s = first; s != NULL; s = (s->next)) {
+				if (IntSet_equals(dst, s->val)) {
+					isContained = true;
+					break;
+				}
+			}
+			if (isContained) {
+				IntSet_free(dst);
+			}
+			else {
+				listState* s = (listState*)malloc(sizeof(listState));
+				(s->val) = dst;
+				(s->i) = numStates++;
+				(s->next) = NULL;
+				(last->next) = s;
+				last = s;
+			}
+		}
+	}
+	while (first != NULL) {
+		listState* next = (first->next);
+		IntSet_free(first->val);
+		free(first);
+		first = next;
+	}
+	return numStates;
+}
+
+//Compare hashed and list-based subset construction on NFAs with exponentially large DFAs
+static void benchSubsetConstruct() {
+	printf("subsetConstruct, k-th symbol from the end is '1':\n");
+	for (int k = 6; k <= 16; k += 2) {
+		NFA* nfa = kthFromLast(k);
+
+		double t0 = now();
+		DFA* dfa = subsetConstruct(nfa);
+		double hashed = now() - t0;
+
+		printf("  k=%2d  states=%6d  hashed=%9.4fs", k, DFA_get_size(dfa), hashed);
+		if (k <= 14) {
+			t0 = now();
+			int listStates = subsetConstructList(nfa);
+			double list = now() - t0;
+			printf("  list=%9.4fs  speedup=%7.1fx%s", list, list / hashed, listStates == DFA_get_size(dfa) ? "" : " (MISMATCH)");
+		}
+		printf("\n");
+		DFA_free(dfa);
+		NFA_free(nfa);
+	}
+}
+
+//Subset construction on NFAs wider than a single 64-bit IntSet word
+static void benchWideNFA() {
+	printf("subsetConstruct, ends with a random literal:\n");
+	for (int n = 32; n <= 4096; n *= 4) {
+		NFA* nfa = endsWithLiteral(n, 1);
+		double t0 = now();
+		DFA* dfa = subsetConstruct(nfa);
+		double t = now() - t0;
+		printf("  nfa=%5d  states=%6d  time=%9.4fs\n", n, DFA_get_size(dfa), t);
+		DFA_free(dfa);
+		NFA_free(nfa);
+	}
+}
+
+//True if the two DFAs have the same states, numbered the same way, with the same transitions and matches
+static bool sameDFA(const DFA* a, const DFA* b) {
+	if (DFA_get_size(a) != DFA_get_size(b)) {
+		return false;
+	}
+	for (int q = 0; q < DFA_get_size(a); q++) {
+		const int* x;
+		const int* y;
+		int n = DFA_get_matches(a, q, &x);
+		if (DFA_get_accepting(a, q) != DFA_get_accepting(b, q) || n != DFA_get_matches(b, q, &y)
+			|| (n > 0 && memcmp(x, y, n * sizeof(int)) != 0)) {
+			return false;
+		}
+		for (int sym = 0; sym < sigma; sym++) {
+			if (DFA_get_transition(a, q, (char)sym) != DFA_get_transition(b, q, (char)sym)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+//Random string of len symbols drawn from alphabet, NUL-terminated
+static char* randomInput(size_t len, const char* alphabet, unsigned seed) {
+	size_t n = strlen(alphabet);
+	char* input = (char*)malloc(len + 1);
+	for (size_t i = 0; i < len; i++) {
+		seed = seed * 1103515245 + 12345;
+		input[i] = alphabet[(seed >> 16) % n];
+	}
+	input[len] = '\0';
+	return input;
+}
+
+//Reference NFA simulation as NFA_execute was before NFA_Context: a new set and iterator per character
+static bool nfaExecuteAlloc(const NFA* nfa, const char* input) {
+	IntSet* curr = IntSet_new(nfa->numStates);
+	IntSet_add(curr, 0);
+	for (int i = 0; input[i] != '\0'; i++) {
+		IntSet* next = IntSet_new(nfa->numStates);
+		IntSetIterator* iter = IntSet_iterator(curr);
+		while (IntSetIterator_has_next(iter)) {
+			NFA_get_transitions(nfa, IntSetIterator_next(iter), input[i], next);
+		}
+		free(iter);
+		IntSet_free(curr);
+		curr = next;
+		if (IntSet_is_empty(curr)) {
+			IntSet_free(curr);
+			return false;
+		}
+	}
+	bool accepted = false;
+	IntSetIterator* iter = IntSet_iterator(curr);
+	while (IntSetIterator_has_next(iter)) {
+		if (NFA_get_accepting(nfa, IntSetIterator_next(iter))) {
+			accepted = true;
+		}
+	}
+	free(iter);
+	IntSet_free(curr);
+	return accepted;
+}
+
+//NFA_execute against the allocating reference on multi-megabyte inputs
+static void benchNFAExecute() {
+	size_t len = 4 << 20;
+	char* input = randomInput(len, "abcdefghijklmnopqrstuvwxyz", 19);
+	struct {
+		const char* name;
+		NFA* nfa;
+	} cases[] = {
+		{ "endInMAN", endInMANNFA() },
+		{ "washington", washingtonNFA() },
+		{ "literal-200", endsWithLiteral(200, 3) },
+		{ "repeat-20", repeatedLetter(20) },
+	};
+	printf("NFA_execute, %zu MB of random lowercase input:\n", len >> 20);
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		NFA_compress(cases[i].nfa);
+		double t0 = now();
+		bool a = nfaExecuteAlloc(cases[i].nfa, input);
+		double alloc = now() - t0;
+		t0 = now();
+		bool b = NFA_execute(cases[i].nfa, input);
+		double swapped = now() - t0;
+		printf("  %-12s  states=%4d  allocating=%7.1f MB/s  swapped=%7.1f MB/s  speedup=%5.1fx%s\n", cases[i].name,
+			NFA_get_size(cases[i].nfa), len / alloc / 1e6, len / swapped / 1e6, alloc / swapped, a == b ? "" : " (MISMATCH)");
+		NFA_free(cases[i].nfa);
+	}
+	free(input);
+}
+
+//DFA_execute throughput on DFAs with one and two byte state ids
+static void benchScan() {
+	size_t len = 16 << 20;
+	char* input = randomInput(len, "01", 7);
+	printf("DFA_execute, %zu MB of random binary input:\n", len >> 20);
+	for (int k = 6; k <= 12; k += 6) {
+		NFA* nfa = kthFromLast(k);
+		DFA* dfa = subsetConstruct(nfa);
+		double t0 = now();
+		DFA_execute(dfa, input);
+		double t = now() - t0;
+		printf("  states=%6d  width=%d  classes=%3d  %8.1f MB/s\n", DFA_get_size(dfa), (dfa->width), (dfa->numClasses), len / t / 1e6);
+		DFA_free(dfa);
+		NFA_free(nfa);
+	}
+	free(input);
+}
+
+//Seconds for DFA_execute on input
+static double timeScan(DFA* dfa, char* input) {
+	double t0 = now();
+	DFA_execute(dfa, input);
+	return now() - t0;
+}
+
+//DFA_execute with and without accelerated self-loops
+static void benchAccelerate() {
+	size_t len = 64 << 20;
+	char* text = randomInput(len, "abcdefghijklmnopqrstuvwxyz ", 29);
+	char* binary = randomInput(len, "01", 31);
+	struct { const char* name; NFA* nfa; char* input; } cases[] = {
+		{ "endInMAN, lowercase text", endInMANNFA(), text },
+		{ ".*(qj|zx)v, lowercase text", Regex_compile(".*(qj|zx)v", NULL), text },
+		{ "kthFromLast(6), binary", kthFromLast(6), binary },
+	};
+	printf("DFA_execute with accelerated self-loops, %zu MB:\n", len >> 20);
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		DFA* dfa = subsetConstruct(cases[i].nfa);
+		int accelerated = DFA_accelerate(dfa, DFA_ACCEL_ESCAPES);
+		double fast = timeScan(dfa, cases[i].input);
+		DFA_accelerate(dfa, -1);
+		double plain = timeScan(dfa, cases[i].input);
+		printf("  %-28s  accelerated=%2d/%2d  %8.1f MB/s plain  %8.1f MB/s accelerated\n", cases[i].name,
+			accelerated, DFA_get_size(dfa), len / plain / 1e6, len / fast / 1e6);
+		DFA_free(dfa);
+		NFA_free(cases[i].nfa);
+	}
+	free(text);
+	free(binary);
+}
+
+//DFA_feed over packet-sized chunks against DFA_execute over the whole input
+static void benchStream() {
+	size_t len = 16 << 20;
+	size_t chunk = 1500;
+	char* input = randomInput(len, "01", 13);
+	NFA* nfa = kthFromLast(8);
+	DFA* dfa = subsetConstruct(nfa);
+	DFA_Context* ctx = DFA_context_new(dfa);
+
+	double whole = timeScan(dfa, input);
+	double t0 = now();
+	for (size_t i = 0; i < len; i += chunk) {
+		DFA_feed(ctx, (const uint8_t*)input + i, (len - i < chunk) ? len - i : chunk);
+	}
+	bool accepted = DFA_finish(ctx);
+	double streamed = now() - t0;
+	printf("DFA_feed, %zu MB in %zu byte chunks:\n", len >> 20, chunk);
+	printf("  execute=%8.1f MB/s  feed=%8.1f MB/s  same result=%s\n", len / whole / 1e6, len / streamed / 1e6,
+		accepted == DFA_execute(dfa, input) ? "yes" : "no");
+
+	DFA_context_free(ctx);
+	DFA_free(dfa);
+	NFA_free(nfa);
+	free(input);
+}
+
+//Array of n random records of 8 to 39 symbols from alphabet
+static char** randomRecords(size_t n, const char* alphabet, unsigned seed) {
+	char** records = (char**)malloc(n * sizeof(char*));
+	for (size_t i = 0; i < n; i++) {
+		seed = seed * 1103515245 + 12345;
+		records[i] = randomInput(8 + (seed >> 16) % 32, alphabet, seed);
+	}
+	return records;
+}
+
+//DFA_execute_batch throughput for different numbers of threads sharing one DFA
+static void benchBatch() {
+	size_t n = 1 << 20;
+	char** records = randomRecords(n, "abcdefghijklmnostw", 17);
+	NFA* nfa = repeatedLetter(10);
+	DFA* dfa = subsetConstructMinimal(nfa);
+	uint64_t* accepted = (uint64_t*)malloc((n + 63) / 64 * sizeof(uint64_t));
+
+	size_t expected = 0;
+	for (size_t i = 0; i < n; i++) {
+		expected += DFA_execute(dfa, records[i]);
+	}
+	printf("DFA_execute_batch, %zu records, %d states:\n", n, DFA_get_size(dfa));
+	int sizes[] = { 1, 2, 4, 0 };
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		ThreadPool* pool = ThreadPool_new(sizes[i]);
+		double t0 = now();
+		DFA_execute_batch(dfa, (const char* const*)records, n, pool, accepted);
+		double t = now() - t0;
+		size_t count = 0;
+		for (size_t w = 0; w < (n + 63) / 64; w++) {
+			count += __builtin_popcountll(accepted[w]);
+		}
+		printf("  threads=%2d  %8.2f M records/s  accepted=%zu%s\n", ThreadPool_size(pool), n / t / 1e6, count,
+			count == expected ? "" : " (MISMATCH)");
+		ThreadPool_free(pool);
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		free(records[i]);
+	}
+	free(records);
+	free(accepted);
+	DFA_free(dfa);
+	NFA_free(nfa);
+}
+
+//One thread: DFA_execute on each record in turn against DFA_execute_interleaved, for DFAs of growing size
+static void benchInterleave() {
+	size_t n = 1 << 20;
+	char** records = randomRecords(n, "01", 19);
+	uint64_t* accepted = (uint64_t*)malloc((n + 63) / 64 * sizeof(uint64_t));
+	printf("DFA_execute_interleaved, %zu binary records, %d lanes, one thread:\n", n, BATCH_LANES);
+	for (int k = 8; k <= 20; k += 6) {
+		NFA* nfa = kthFromLast(k);
+		DFA* dfa = subsetConstruct(nfa);
+		size_t expected = 0;
+		double t0 = now();
+		for (size_t i = 0; i < n; i++) {
+			expected += DFA_execute(dfa, records[i]);
+		}
+		double serial = now() - t0;
+		t0 = now();
+		DFA_execute_interleaved(dfa, (const char* const*)records, n, accepted);
+		double interleaved = now() - t0;
+		size_t count = 0;
+		for (size_t w = 0; w < (n + 63) / 64; w++) {
+			count += __builtin_popcountll(accepted[w]);
+		}
+		printf("  states=%8d  table=%7.1f MB  %8.2f M records/s serial  %8.2f M records/s interleaved%s\n", DFA_get_size(dfa),
+			(double)DFA_get_size(dfa) * (dfa->numClasses) * (dfa->width) / (1 << 20), n / serial / 1e6, n / interleaved / 1e6,
+			count == expected ? "" : " (MISMATCH)");
+		DFA_free(dfa);
+		NFA_free(nfa);
+	}
+	for (size_t i = 0; i < n; i++) {
+		free(records[i]);
+	}
+	free(records);
+	free(accepted);
+}
+
+//State counts and scan throughput before and after DFA_minimize
+static void benchMinimize() {
+	size_t len = 16 << 20;
+	char* input = randomInput(len, "abcdefghijklmnostwxyz", 11);
+	input[0] = 'a';							//xyz halts at once on inputs starting with x, y or z
+	struct {
+		const char* name;
+		NFA* nfa;
+	} cases[] = {
+		{ "endInMAN", endInMANNFA() },
+		{ "washington", washingtonNFA() },
+		{ "xyz", xyzNFA() },
+		{ "repeat-10", repeatedLetter(10) },
+		{ "repeat-14", repeatedLetter(14) },
+		{ "random-32", randomNFA(32, 6) },
+	};
+	printf("DFA_minimize, %zu MB of random input:\n", len >> 20);
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		DFA* dfa = subsetConstruct(cases[i].nfa);
+		double t0 = now();
+		DFA* min = DFA_minimize(dfa);
+		double t = now() - t0;
+		printf("  %-10s  states=%6d -> %6d  minimize=%8.4fs  scan=%8.1f -> %8.1f MB/s\n", cases[i].name,
+			DFA_get_size(dfa), DFA_get_size(min), t, len / timeScan(dfa, input) / 1e6, len / timeScan(min, input) / 1e6);
+		DFA_free(dfa);
+		DFA_free(min);
+		NFA_free(cases[i].nfa);
+	}
+	free(input);
+}
+
+//LazyDFA against NFA_execute and a full subset construction, with a large and a small cache
+static void benchLazyDFA() {
+	size_t len = 4 << 20;
+	char* binary = randomInput(len, "01", 23);
+	char* letters = randomInput(len, "abcdefghijklmnostwxyz", 29);
+	struct {
+		const char* name;
+		NFA* nfa;
+		char* input;
+	} cases[] = {
+		{ "kth-10", kthFromLast(10), binary },
+		{ "kth-18", kthFromLast(18), binary },
+		{ "washington", washingtonNFA(), letters },
+		{ "repeat-14", repeatedLetter(14), letters },
+	};
+	size_t budgets[] = { 8 << 20, 64 << 10 };
+	printf("LazyDFA, %zu MB of random input:\n", len >> 20);
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		NFA* nfa = cases[i].nfa;
+		char* input = cases[i].input;
+		NFA_compress(nfa);
+		double t0 = now();
+		bool expected = NFA_execute(nfa, input);
+		double nfaTime = now() - t0;
+		t0 = now();
+		DFA* dfa = subsetConstruct(nfa);
+		bool full = DFA_execute(dfa, input);
+		double dfaTime = now() - t0;
+		printf("  %-10s  nfa=%7.1f MB/s  subset+dfa=%7.1f MB/s (%d states)%s\n", cases[i].name, len / nfaTime / 1e6,
+			len / dfaTime / 1e6, DFA_get_size(dfa), full == expected ? "" : " (MISMATCH)");
+		for (size_t b = 0; b < sizeof(budgets) / sizeof(budgets[0]); b++) {
+			LazyDFA* ldfa = LazyDFA_new(nfa, budgets[b]);
+			t0 = now();
+			bool lazy = LazyDFA_execute(ldfa, input);
+			double lazyTime = now() - t0;
+			printf("              lazy budget=%5zu KB  %7.1f MB/s  cached=%6d  flushes=%5d%s\n", budgets[b] >> 10,
+				len / lazyTime / 1e6, LazyDFA_get_size(ldfa), LazyDFA_get_flushes(ldfa), lazy == expected ? "" : " (MISMATCH)");
+			LazyDFA_free(ldfa);
+		}
+		DFA_free(dfa);
+		NFA_free(nfa);
+	}
+	free(binary);
+	free(letters);
+}
+
+//Pattern for strings that end in one of n pseudo-random lowercase words of 4 to 11 letters
+static char* wordsPattern(int n, unsigned seed) {
+	char* pattern = (char*)malloc(n * 13 + 4);
+	strcpy(pattern, ".*(");
+	size_t len = 3;
+	for (int i = 0; i < n; i++) {
+		seed = seed * 1103515245 + 12345;
+		int wordLen = 4 + (seed >> 16) % 8;
+		for (int j = 0; j < wordLen; j++) {
+			seed = seed * 1103515245 + 12345;
+			pattern[len++] = (char)('a' + (seed >> 16) % 26);
+		}
+		pattern[len++] = (i == n - 1) ? ')' : '|';
+	}
+	pattern[len] = '\0';
+	return pattern;
+}
+
+//Regex_compile and the constructions that follow it, on alternations of many words
+static void benchRegex() {
+	size_t len = 4 << 20;
+	char* input = randomInput(len, "abcdefghijklmnopqrstuvwxyz", 31);
+	printf("Regex_compile, alternations of random words, %zu MB of random lowercase input:\n", len >> 20);
+	for (int n = 10; n <= 160; n *= 4) {
+		char* pattern = wordsPattern(n, n);
+		double t0 = now();
+		NFA* nfa = Regex_compile(pattern, NULL);
+		double compile = now() - t0;
+		t0 = now();
+		DFA* dfa = subsetConstructMinimal(nfa);
+		double construct = now() - t0;
+		LazyDFA* ldfa = LazyDFA_new(nfa, 8 << 20);
+		t0 = now();
+		bool lazy = LazyDFA_execute(ldfa, input);
+		double scan = now() - t0;
+		printf("  words=%5d  nfa states=%6d  compile=%8.4fs  minimal dfa=%6d states in %8.4fs  lazy=%7.1f MB/s%s\n", n,
+			NFA_get_size(nfa), compile, DFA_get_size(dfa), construct, len / scan / 1e6,
+			lazy == DFA_execute(dfa, input) ? "" : " (MISMATCH)");
+		LazyDFA_free(ldfa);
+		DFA_free(dfa);
+		NFA_free(nfa);
+		free(pattern);
+	}
+	free(input);
+}
+
+//Text of len bytes made of words drawn at random from the given list, NUL-terminated
+static char* randomWords(size_t len, const char* const* words, int n, unsigned seed) {
+	char* input = (char*)malloc(len + 1);
+	size_t i = 0;
+	while (i < len) {
+		seed = seed * 1103515245 + 12345;
+		const char* w = words[(seed >> 16) % n];
+		while (*w != '\0' && i < len) {
+			input[i++] = *w++;
+		}
+	}
+	input[len] = '\0';
+	return input;
+}
+
+//DFA_execute over UTF-8 text and over ASCII text, with patterns compiled by Regex_compile_utf8
+static void benchUTF8() {
+	size_t len = 16 << 20;
+	const char* utf8[] = { "der ", "Stra\xc3\x9f" "e ", "caf\xc3\xa9 ", "na\xc3\xafve ", "\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e ",
+		"\xce\xb1\xce\xb2\xce\xb3 ", "and " };
+	const char* ascii[] = { "der ", "Strasse ", "cafe ", "naive ", "nihongo ", "abg ", "and " };
+	const char* patterns[] = { ".*Stra(\xc3\x9f|ss)e", ".*[\xce\xb1-\xcf\x89]+ [^ ]+", ".*[\xe4\xb8\x80-\xe9\xbf\xbf]+." };
+	char* text = randomWords(len, utf8, 7, 37);
+	char* plain = randomWords(len, ascii, 7, 37);
+	printf("Regex_compile_utf8, DFA_execute on %zu MB of UTF-8 and of ASCII words:\n", len >> 20);
+	for (int i = 0; i < 3; i++) {
+		NFA* nfa = Regex_compile_utf8(patterns[i], NULL);
+		DFA* dfa = subsetConstructMinimal(nfa);
+		double t0 = now();
+		DFA_execute(dfa, text);
+		double t = now() - t0;
+		t0 = now();
+		DFA_execute(dfa, plain);
+		double tp = now() - t0;
+		printf("  nfa states=%4d  dfa states=%3d  classes=%3d  UTF-8=%8.1f MB/s  ASCII=%8.1f MB/s\n",
+			NFA_get_size(nfa), DFA_get_size(dfa), (dfa->numClasses), len / t / 1e6, len / tp / 1e6);
+		DFA_free(dfa);
+		NFA_free(nfa);
+	}
+	free(plain);
+	free(text);
+}
+
+//Memory of regex NFAs as edge lists against the full table of sets they replace, and the subset construction on them
+static void benchSparseNFA() {
+	printf("Sparse NFA, alternations of random words:\n");
+	for (int n = 80; n <= 1280; n *= 4) {
+		char* pattern = wordsPattern(n, n);
+		double t0 = now();
+		NFA* nfa = Regex_compile(pattern, NULL);
+		double compile = now() - t0;
+		int states = NFA_get_size(nfa);
+		size_t sparse = Arena_get_size(nfa->arena) + states * sizeof(NFA_EdgeList);
+		size_t dense = (size_t)states * sigma * (sizeof(IntSet) + IntSet_words_for(states) * sizeof(uint64_t));
+		printf("  words=%5d  nfa states=%6d  edges=%6d  memory=%8.1f KB  dense table=%10.1f KB  compile=%8.4fs", n, states,
+			(nfa->numEdges), sparse / 1024.0, dense / 1024.0, compile);
+		if (n <= 320) {
+			t0 = now();
+			DFA* dfa = subsetConstruct(nfa);
+			printf("  subsetConstruct=%8.4fs (%d states)", now() - t0, DFA_get_size(dfa));
+			DFA_free(dfa);
+		}
+		printf("\n");
+		NFA_free(nfa);
+		free(pattern);
+	}
+}
+
+//subsetConstructParallel on pools of several sizes against subsetConstruct
+static void benchParallelSubset() {
+	char* pattern = wordsPattern(160, 160);
+	struct {
+		const char* name;
+		NFA* nfa;
+	} cases[] = {
+		{ "kth-18", kthFromLast(18) },
+		{ "words-160", Regex_compile(pattern, NULL) },
+	};
+	printf("subsetConstructParallel:\n");
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		double t0 = now();
+		DFA* serial = subsetConstruct(cases[i].nfa);
+		printf("  %-10s  states=%6d  serial=%8.4fs", cases[i].name, DFA_get_size(serial), now() - t0);
+		int sizes[] = { 1, 2, 4, 0 };
+		for (size_t j = 0; j < sizeof(sizes) / sizeof(sizes[0]); j++) {
+			ThreadPool* pool = ThreadPool_new(sizes[j]);
+			t0 = now();
+			DFA* dfa = subsetConstructParallel(cases[i].nfa, pool);
+			printf("  threads=%d %8.4fs%s", ThreadPool_size(pool), now() - t0, sameDFA(serial, dfa) ? "" : " (MISMATCH)");
+			DFA_free(dfa);
+			ThreadPool_free(pool);
+		}
+		printf("\n");
+		DFA_free(serial);
+		NFA_free(cases[i].nfa);
+	}
+	free(pattern);
+}
+
+//NFA_execute with the bit-parallel form of the NFA against the state-by-state scan
+static void benchBitNFA() {
+	size_t len = 4 << 20;
+	char* text = randomInput(len, "abcdefghijklmnopqrstuvwxyz", 37);
+	char* binary = randomInput(len, "01", 41);
+	struct { const char* name; NFA* nfa; char* input; } cases[] = {
+		{ "kth-20", kthFromLast(20), binary },
+		{ "washington", washingtonNFA(), text },
+		{ "literal-60", endsWithLiteral(60, 5), text },
+		{ "literal-200", endsWithLiteral(200, 3), text },
+		{ ".*(qj|zx)v", Regex_compile(".*(qj|zx)v", NULL), text },
+	};
+	printf("Bit-parallel NFA, %zu MB of random input:\n", len >> 20);
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		NFA* nfa = cases[i].nfa;
+		NFA_compress(nfa);
+		struct BitNFA* bits = (nfa->bits);
+		if (bits == NULL) {
+			printf("  %-12s  not bit-parallel\n", cases[i].name);
+			NFA_free(nfa);
+			continue;
+		}
+		(nfa->bits) = NULL;							//Scan state by state
+		double t0 = now();
+		bool a = NFA_execute(nfa, cases[i].input);
+		double generic = now() - t0;
+		(nfa->bits) = bits;
+		t0 = now();
+		bool b = NFA_execute(nfa, cases[i].input);
+		double parallel = now() - t0;
+		printf("  %-12s  states=%4d  positions=%4d  words=%d  state by state=%7.1f MB/s  bit-parallel=%8.1f MB/s  speedup=%5.1fx%s\n",
+			cases[i].name, NFA_get_size(nfa), BitNFA_get_size(bits), BitNFA_words(bits), len / generic / 1e6,
+			len / parallel / 1e6, generic / parallel, a == b ? "" : " (MISMATCH)");
+		NFA_free(nfa);
+	}
+	free(text);
+	free(binary);
+}
+
+//Report callback that counts matches
+static void countMatch(void* arg, int pattern, size_t end) {
+	(void)pattern;
+	(void)end;
+	(*(size_t*)arg)++;
+}
+
+//One DFA_match_all pass over a set of patterns against one pass per pattern
+static void benchMultiPattern() {
+	size_t len = 4 << 20;
+	char* input = randomInput(len, "abcdefghijklmnopqrstuvwxyz", 37);
+	printf("DFA_match_all, patterns .*word, %zu MB of random lowercase input:\n", len >> 20);
+	for (int n = 4; n <= 64; n *= 4) {
+		char** patterns = (char**)malloc(n * sizeof(char*));
+		unsigned seed = n;
+		for (int i = 0; i < n; i++) {
+			patterns[i] = (char*)malloc(8);
+			strcpy(patterns[i], ".*");
+			for (int j = 2; j < 5; j++) {
+				seed = seed * 1103515245 + 12345;
+				patterns[i][j] = (char)('a' + (seed >> 16) % 26);
+			}
+			patterns[i][5] = '\0';
+		}
+
+		NFA* nfa = Regex_compile_set((const char* const*)patterns, n, NULL);
+		DFA* dfa = subsetConstructMinimal(nfa);
+		size_t combined = 0;
+		double t0 = now();
+		DFA_match_all(dfa, (const uint8_t*)input, len, countMatch, &combined);
+		double one = now() - t0;
+
+		size_t separate = 0;
+		double each = 0;
+		for (int i = 0; i < n; i++) {
+			NFA* single = Regex_compile(patterns[i], NULL);
+			DFA* sdfa = subsetConstructMinimal(single);
+			t0 = now();
+			DFA_match_all(sdfa, (const uint8_t*)input, len, countMatch, &separate);
+			each += now() - t0;
+			DFA_free(sdfa);
+			NFA_free(single);
+			free(patterns[i]);
+		}
+		printf("  patterns=%3d  states=%5d  one pass=%8.4fs  one per pattern=%8.4fs  matches=%zu%s\n", n, DFA_get_size(dfa),
+			one, each, combined, combined == separate ? "" : " (MISMATCH)");
+		DFA_free(dfa);
+		NFA_free(nfa);
+		free(patterns);
+	}
+	free(input);
+}
+
+//Non-overlapping matches found by trying an anchored match at every offset, as without Search
+static size_t searchEveryOffset(const DFA* dfa, const char* text, size_t len) {
+	size_t count = 0;
+	size_t pos = 0;
+	while (pos < len) {
+		int state = 0;
+		size_t end = 0;
+		bool found = false;
+		for (size_t i = pos; i < len && state != HALT; i++) {
+			state = DFA_get_transition(dfa, state, text[i]);
+			if (state != HALT && DFA_get_accepting(dfa, state)) {
+				end = i + 1;
+				found = true;
+			}
+		}
+		if (found) {
+			count++;
+			pos = end;
+		}
+		else {
+			pos++;
+		}
+	}
+	return count;
+}
+
+//SearchIterator over log-like text against an anchored match attempt from every offset
+static void benchSearch() {
+	size_t len = 16 << 20;
+	char* text = randomInput(len, "abcdefghijklmnopqrstuvwxyz         0123456789", 41);
+	for (size_t i = 0; i + 16 < len; i += 4000) {
+		memcpy(text + i, "error 404 ", 10);
+	}
+	NFA* nfa = Regex_compile("err(or)? [0-9]+", NULL);
+	DFA* dfa = subsetConstructMinimal(nfa);
+	Search* search = Search_new(nfa, SEARCH_LONGEST);
+
+	double t0 = now();
+	SearchIterator* iter = Search_iterator(search, (const uint8_t*)text, len);
+	size_t count = 0;
+	size_t start, end;
+	while (SearchIterator_next(iter, &start, &end)) {
+		count++;
+	}
+	SearchIterator_free(iter);
+	double t = now() - t0;
+	t0 = now();
+	size_t expected = searchEveryOffset(dfa, text, len);
+	double naive = now() - t0;
+	printf("Search, %zu MB of log-like text:\n", len >> 20);
+	printf("  matches=%zu  iterator=%7.1f MB/s  every offset=%7.1f MB/s%s\n", count, len / t / 1e6, len / naive / 1e6,
+		count == expected ? "" : " (MISMATCH)");
+	Search_free(search);
+	DFA_free(dfa);
+	NFA_free(nfa);
+
+	//Long words, few of which end in a digit: an anchored attempt inside a word reads on to its end
+	len = 4 << 20;
+	for (size_t i = 0; i < len; i++) {
+		text[i] = (i % 200 == 199) ? ' ' : (i % 10000 == 198) ? '7' : text[i] >= 'a' ? text[i] : 'e';
+	}
+	text[len] = '\0';
+	nfa = Regex_compile("[a-z]+[0-9]", NULL);
+	dfa = subsetConstructMinimal(nfa);
+	search = Search_new(nfa, SEARCH_LONGEST);
+	t0 = now();
+	iter = Search_iterator(search, (const uint8_t*)text, len);
+	count = 0;
+	while (SearchIterator_next(iter, &start, &end)) {
+		count++;
+	}
+	SearchIterator_free(iter);
+	t = now() - t0;
+	t0 = now();
+	expected = searchEveryOffset(dfa, text, len);
+	naive = now() - t0;
+	printf("Search, %zu MB of 199-letter words, one in 50 ending in a digit:\n", len >> 20);
+	printf("  matches=%zu  iterator=%7.1f MB/s  every offset=%7.1f MB/s%s\n", count, len / t / 1e6, len / naive / 1e6,
+		count == expected ? "" : " (MISMATCH)");
+	Search_free(search);
+	DFA_free(dfa);
+	NFA_free(nfa);
+	free(text);
+}
+
+//Building a large DFA against mapping a saved copy of it
+static void benchMap() {
+	size_t len = 16 << 20;
+	const char* path = "bench-dfa.bin";
+	char* input = randomInput(len, "01", 37);
+	NFA* nfa = kthFromLast(18);
+	double t0 = now();
+	DFA* dfa = subsetConstructMinimal(nfa);
+	double build = now() - t0;
+	t0 = now();
+	bool saved = DFA_save(dfa, path);
+	double save = now() - t0;
+	t0 = now();
+	DFA* mapped = saved ? DFA_map(path) : NULL;
+	double map = now() - t0;
+	printf("DFA_save and DFA_map, %d states:\n", DFA_get_size(dfa));
+	if (mapped == NULL) {
+		printf("  could not save or map %s\n", path);
+	}
+	else {
+		double heap = timeScan(dfa, input);
+		double file = timeScan(mapped, input);
+		printf("  build=%8.4fs  save=%8.4fs  map=%8.6fs  scan=%8.1f MB/s heap  %8.1f MB/s mapped%s\n", build, save, map,
+			len / heap / 1e6, len / file / 1e6, DFA_execute(dfa, input) == DFA_execute(mapped, input) ? "" : " (MISMATCH)");
+		DFA_free(mapped);
+	}
+	remove(path);
+	DFA_free(dfa);
+	NFA_free(nfa);
+	free(input);
+}
+
+//One DFA folded from allow and deny policies with DFA_union and DFA_difference, against one scan per policy
+static void benchProduct() {
+	size_t n = 1 << 18;
+	char** records = randomRecords(n, "abcdefghijklmnopqrstuvwxyz", 59);
+	const char* allow[] = { ".*ab.*", ".*(cat|dog).*", ".*x[a-e]y.*", ".*qu.*", ".*zz.*", ".*(tree|leaf).*", ".*k.k.*", ".*mno.*" };
+	const char* deny[] = { ".*ba.*", ".*j[aeiou]j.*" };
+	int nallow = sizeof(allow) / sizeof(allow[0]);
+	int ndeny = sizeof(deny) / sizeof(deny[0]);
+	DFA* policies[16];
+	for (int i = 0; i < nallow + ndeny; i++) {
+		NFA* nfa = Regex_compile(i < nallow ? allow[i] : deny[i - nallow], NULL);
+		policies[i] = subsetConstructMinimal(nfa);
+		NFA_free(nfa);
+	}
+
+	double t0 = now();
+	DFA* allowed = DFA_union(policies[0], policies[1]);
+	for (int i = 2; i < nallow; i++) {
+		DFA* next = DFA_union(allowed, policies[i]);
+		DFA_free(allowed);
+		allowed = next;
+	}
+	DFA* folded = allowed;
+	for (int i = nallow; i < nallow + ndeny; i++) {
+		DFA* next = DFA_difference(folded, policies[i]);
+		DFA_free(folded);
+		folded = next;
+	}
+	double fold = now() - t0;
+
+	t0 = now();
+	size_t expected = 0;
+	for (size_t r = 0; r < n; r++) {
+		bool ok = false;
+		for (int i = 0; i < nallow && !ok; i++) {
+			ok = DFA_execute(policies[i], records[r]);
+		}
+		for (int i = nallow; i < nallow + ndeny && ok; i++) {
+			ok = !DFA_execute(policies[i], records[r]);
+		}
+		expected += ok;
+	}
+	double each = now() - t0;
+	t0 = now();
+	size_t count = 0;
+	for (size_t r = 0; r < n; r++) {
+		count += DFA_execute(folded, records[r]);
+	}
+	double once = now() - t0;
+	printf("DFA_union and DFA_difference, %d allow and %d deny policies, %zu records:\n", nallow, ndeny, n);
+	printf("  folded dfa=%4d states in %8.4fs  per policy=%7.2f M records/s  folded=%7.2f M records/s  speedup=%5.1fx%s\n",
+		DFA_get_size(folded), fold, n / each / 1e6, n / once / 1e6, each / once, count == expected ? "" : " (MISMATCH)");
+
+	for (int i = 0; i < nallow + ndeny; i++) {
+		DFA_free(policies[i]);
+	}
+	DFA_free(folded);
+	for (size_t r = 0; r < n; r++) {
+		free(records[r]);
+	}
+	free(records);
+}
+
+//1 if the NFA accepts len bytes of input and the DFA does not, -1 for the reverse, 0 if they agree
+static int automataMatch(const NFA* nfa, const DFA* dfa, const uint8_t* input, size_t len) {
+	NFA_Context* nctx = NFA_context_new(nfa);
+	NFA_feed(nctx, input, len);
+	bool byNFA = NFA_finish(nctx);
+	NFA_context_free(nctx);
+	DFA_Context* dctx = DFA_context_new(dfa);
+	DFA_feed(dctx, input, len);
+	bool byDFA = DFA_finish(dctx);
+	DFA_context_free(dctx);
+	return (int)byNFA - (int)byDFA;
+}
+
+//DFA_equivalent and the inclusion checks on large DFAs, against the same DFA renumbered and with one state changed
+static void benchEquivalence() {
+	printf("DFA_equivalent and DFA_included, k-th symbol from the end is '1':\n");
+	for (int k = 12; k <= 18; k += 3) {
+		NFA* nfa = kthFromLast(k);
+		DFA* dfa = subsetConstruct(nfa);
+		DFA* renumbered = DFA_minimize(dfa);
+		DFA* changed = DFA_minimize(dfa);
+		int flip = DFA_get_size(changed) - 1;					//Furthest from the start in breadth-first order
+		DFA_set_accepting(changed, flip, !DFA_get_accepting(changed, flip));
+
+		double t0 = now();
+		bool same = DFA_equivalent(dfa, renumbered, NULL);
+		double equal = now() - t0;
+		char* witness = NULL;
+		t0 = now();
+		bool differ = !DFA_equivalent(dfa, changed, &witness);
+		double unequal = now() - t0;
+		t0 = now();
+		bool included = DFA_included(dfa, renumbered, NULL);
+		double include = now() - t0;
+		t0 = now();
+		bool nfaSame = NFA_equivalent(nfa, dfa, NULL);
+		double nfaEqual = now() - t0;
+		printf("  states=%7d  equivalent=%8.4fs  different=%8.4fs (counterexample of %zu)  included=%8.4fs  NFA_equivalent=%8.4fs%s\n",
+			DFA_get_size(dfa), equal, unequal, (witness != NULL) ? strlen(witness) : 0, include, nfaEqual,
+			same && differ && included && nfaSame && DFA_execute(dfa, witness) != DFA_execute(changed, witness) ? "" : " (MISMATCH)");
+		free(witness);
+		DFA_free(changed);
+		DFA_free(renumbered);
+		DFA_free(dfa);
+		NFA_free(nfa);
+	}
+
+	//An NFA accepting only "\0" against a DFA that accepts nothing and keeps 0 in a class with other bytes.
+	//The shortest counterexample is that one NUL byte, which the NFA must accept and the DFA reject.
+	NFA* nul = NFA_new(2);
+	NFA_add_transition(nul, 0, '\0', 1);
+	NFA_set_accepting(nul, 1, true);
+	DFA* none = DFA_new(1);
+	DFA_compress(none);
+	char* over = NULL;
+	char* either = NULL;
+	bool included = NFA_included(nul, none, &over);
+	bool equal = NFA_equivalent(nul, none, &either);
+	bool witnessed = !included && !equal && automataMatch(nul, none, (const uint8_t*)over, 1) == 1
+		&& automataMatch(nul, none, (const uint8_t*)either, 1) == 1;
+	printf("  NUL edge: NFA_included counterexample \\x%02x, NFA_equivalent \\x%02x%s\n", (uint8_t)over[0], (uint8_t)either[0],
+		witnessed ? "" : " (MISMATCH)");
+	free(over);
+	free(either);
+	DFA_free(none);
+	NFA_free(nul);
+}
+
+//Same StaticDFA as evenOnesZeros in Auto.c, which has a main of its own and is not linked into bench
+static const uint8_t evenOnesZerosTable[4][256] = {
+	[0] = { ['0'] = STATIC_DFA_TO(2), ['1'] = STATIC_DFA_TO(1) },
+	[1] = { ['0'] = STATIC_DFA_TO(3), ['1'] = STATIC_DFA_TO(0) },
+	[2] = { ['0'] = STATIC_DFA_TO(0), ['1'] = STATIC_DFA_TO(3) },
+	[3] = { ['0'] = STATIC_DFA_TO(1), ['1'] = STATIC_DFA_TO(2) },
+};
+static const bool evenOnesZerosAccept[4] = { true, false, false, false };
+static const StaticDFA evenOnesZerosStatic = STATIC_DFA(evenOnesZerosTable, evenOnesZerosAccept);
+
+//StaticDFA_execute against DFA_execute on the same DFA built at runtime
+static void benchStaticDFA() {
+	size_t len = 64 << 20;
+	char* input = randomInput(len, "01", 23);
+	DFA* dfa = StaticDFA_to_DFA(&evenOnesZerosStatic);
+	double t0 = now();
+	bool dynamic = DFA_execute(dfa, input);
+	double t = now() - t0;
+	t0 = now();
+	bool fixed = StaticDFA_execute(&evenOnesZerosStatic, input);
+	double ts = now() - t0;
+	printf("StaticDFA_execute, %zu MB of random binary input:\n", len >> 20);
+	printf("  DFA_execute=%8.1f MB/s  StaticDFA_execute=%8.1f MB/s%s\n", len / t / 1e6, len / ts / 1e6, dynamic == fixed ? "" : " (MISMATCH)");
+	DFA_free(dfa);
+	free(input);
+}
+
+//DFA with n states and random transitions on the bytes 0, 1, 'a', 0x80 and 0xff; about half the states accept
+static DFA* randomDFA(int n, unsigned seed) {
+	static const uint8_t symbols[] = { 0, 1, 'a', 0x80, 0xff };
+	DFA* dfa = DFA_new(n);
+	for (int q = 0; q < n; q++) {
+		seed = seed * 1103515245 + 12345;
+		DFA_set_accepting(dfa, q, (seed >> 16) % 2 == 0);
+		for (int j = 0; j < 5; j++) {
+			seed = seed * 1103515245 + 12345;
+			if ((seed >> 16) % 4 != 0) {
+				DFA_set_transition(dfa, q, (char)symbols[j], (seed >> 8) % n);
+			}
+		}
+	}
+	return dfa;
+}
+
+/*
+* DFA_generate_c and DFA_generate_static, checked end to end: each case
+* is written in both styles of C and, if it is small enough, as a
+* StaticDFA header, and compiled with $CC (default cc) into a driver that
+* reads records of a length byte and that many bytes and prints whether
+* name_match and name (or StaticDFA_match and StaticDFA_execute) accept
+* each. The answers are compared with DFA_feed and DFA_execute on the same
+* records. Inputs mix words that the case's DFA reads with NUL and bytes
+* >= 128, so that name stops at a NUL while name_match reads past it.
+*/
+static void benchCodegen() {
+	const char* cc = (getenv("CC") != NULL) ? getenv("CC") : "cc";
+	const char* slash = strrchr(__FILE__, '/');					//StaticDFA.h is next to this file
+	char include[256];
+	snprintf(include, sizeof(include), "%.*s", (slash != NULL) ? (int)(slash - __FILE__) : 1, (slash != NULL) ? __FILE__ : ".");
+	NFA* utf8 = Regex_compile_utf8("(caf[e\xc3\xa9]|na[i\xc3\xaf]ve)+[0-9]*", NULL);
+	NFA* kth = kthFromLast(8);
+	struct {
+		const char* name;
+		DFA* dfa;
+		const char* words[4];		//Pieces the inputs are made of, besides single NUL and high bytes
+	} cases[] = {
+		{ "regex", subsetConstructMinimal(utf8), { "caf\xc3\xa9", "naive", "na\xc3", "7" } },
+		{ "random", randomDFA(40, 41), { "\x01", "a", "\x80", "\xff" } },
+		{ "wide", subsetConstruct(kth), { "0", "1", "1", "0" } },
+	};
+	NFA_free(utf8);
+	NFA_free(kth);
+	int records = 20000;
+	printf("DFA_generate_c and DFA_generate_static, %d random inputs per matcher, compiled with %s:\n", records, cc);
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		DFA* dfa = cases[i].dfa;
+		uint8_t* input = (uint8_t*)malloc((size_t)records * 64);
+		int* lens = (int*)malloc(records * sizeof(int));
+		char* expected = (char*)malloc(2 * records);
+		FILE* in = fopen("bench-codegen.in", "wb");
+		unsigned seed = 43 + i;
+		for (int r = 0; r < records; r++) {
+			uint8_t* rec = input + (size_t)r * 64;
+			seed = seed * 1103515245 + 12345;
+			int target = (seed >> 16) % 58;
+			lens[r] = 0;
+			while (lens[r] < target) {
+				seed = seed * 1103515245 + 12345;
+				int roll = (seed >> 16) % 16;
+				seed = seed * 1103515245 + 12345;
+				if (roll == 0) {
+					rec[lens[r]++] = 0;
+				}
+				else if (roll == 1) {
+					rec[lens[r]++] = (uint8_t)(128 + (seed >> 16) % 128);
+				}
+				else {
+					const char* word = (cases[i].words)[(seed >> 16) % 4];
+					memcpy(rec + lens[r], word, strlen(word));
+					lens[r] += (int)strlen(word);
+				}
+			}
+			DFA_Context* ctx = DFA_context_new(dfa);
+			DFA_feed(ctx, rec, lens[r]);
+			expected[2 * r] = DFA_finish(ctx) ? '1' : '0';
+			DFA_context_free(ctx);
+			char str[65];
+			memcpy(str, rec, lens[r]);
+			str[lens[r]] = '\0';
+			expected[2 * r + 1] = DFA_execute(dfa, str) ? '1' : '0';
+			fputc(lens[r], in);
+			fwrite(rec, 1, lens[r], in);
+		}
+		fclose(in);
+
+		FILE* driver = fopen("bench-codegen-main.c", "w");
+		fprintf(driver, "#include <stdio.h>\n#include <stdbool.h>\n#include <stddef.h>\n#include <stdint.h>\n\n");
+		fprintf(driver, "bool matcher(const char* input);\nbool matcher_match(const uint8_t* input, size_t len);\n\n");
+		fprintf(driver, "int main(void) {\n\tuint8_t buf[256];\n\tint len;\n");
+		fprintf(driver, "\twhile ((len = getchar()) != EOF && fread(buf, 1, len, stdin) == (size_t)len) {\n");
+		fprintf(driver, "\t\tbuf[len] = 0;\n\t\tputchar(matcher_match(buf, len) ? '1' : '0');\n");
+		fprintf(driver, "\t\tputchar(matcher((const char*)buf) ? '1' : '0');\n\t}\n\treturn 0;\n}\n");
+		fclose(driver);
+		driver = fopen("bench-codegen-static.c", "w");				//The same for the StaticDFA of a generated header
+		fprintf(driver, "#include <stdio.h>\n#include \"bench-codegen.h\"\n\n");
+		fprintf(driver, "int main(void) {\n\tuint8_t buf[256];\n\tint len;\n");
+		fprintf(driver, "\twhile ((len = getchar()) != EOF && fread(buf, 1, len, stdin) == (size_t)len) {\n");
+		fprintf(driver, "\t\tbuf[len] = 0;\n\t\tputchar(StaticDFA_match(&matcher, buf, len) ? '1' : '0');\n");
+		fprintf(driver, "\t\tputchar(StaticDFA_execute(&matcher, (const char*)buf) ? '1' : '0');\n\t}\n\treturn 0;\n}\n");
+		fclose(driver);
+
+		const char* styles[] = { "switch", "table", "static" };
+		for (int st = 0; st < 3; st++) {
+			char command[512];
+			bool generated;
+			double t0 = now();
+			if (st < 2) {
+				generated = DFA_generate_c(dfa, "matcher", (st == 0) ? CODEGEN_SWITCH : CODEGEN_TABLE, "bench-codegen.c");
+				snprintf(command, sizeof(command), "%s -O2 -o bench-codegen bench-codegen-main.c bench-codegen.c"
+					" && ./bench-codegen < bench-codegen.in > bench-codegen.out", cc);
+			}
+			else {
+				if (DFA_get_size(dfa) > STATIC_DFA_MAX_STATES) {
+					printf("  %-7s %-6s  states=%4d  more than a StaticDFA holds\n", cases[i].name, styles[st], DFA_get_size(dfa));
+					continue;
+				}
+				generated = DFA_generate_static(dfa, "matcher", "bench-codegen.h");
+				snprintf(command, sizeof(command), "%s -O2 -I%s -o bench-codegen bench-codegen-static.c"
+					" && ./bench-codegen < bench-codegen.in > bench-codegen.out", cc, include);
+			}
+			bool ran = generated && system(command) == 0;
+			double t = now() - t0;
+			int mismatches = 0;
+			FILE* out = ran ? fopen("bench-codegen.out", "rb") : NULL;
+			if (out != NULL) {
+				for (int r = 0; r < 2 * records; r++) {
+					mismatches += (fgetc(out) != expected[r]);
+				}
+				fclose(out);
+			}
+			printf("  %-7s %-6s  states=%4d  width=%d  generate+compile+run=%7.3fs%s\n", cases[i].name, styles[st],
+				DFA_get_size(dfa), (dfa->width), t, (out == NULL) ? " (COULD NOT COMPILE OR RUN)" : (mismatches == 0) ? "" : " (MISMATCH)");
+		}
+		remove("bench-codegen.in");
+		remove("bench-codegen.out");
+		remove("bench-codegen.c");
+		remove("bench-codegen.h");
+		remove("bench-codegen-main.c");
+		remove("bench-codegen-static.c");
+		remove("bench-codegen");
+		free(expected);
+		free(lens);
+		free(input);
+		DFA_free(dfa);
+	}
+}
+
+/*
+* Regression report: one JSON object per line for each automaton of a
+* fixed set of families and sizes, so that runs before and after a change
+* can be compared by a script.
+*/
+
+//Bytes held by the given NFA, not counting its bit-parallel form
+static size_t nfaBytes(const NFA* nfa) {
+	int n = (nfa->numStates);
+	size_t bytes = sizeof(NFA) + n * (sizeof(bool) + sizeof(NFA_EdgeList)) + Arena_get_size(nfa->arena);
+	if ((nfa->epsilon) != NULL) {						//Epsilon moves and closures, with their bits
+		bytes += 2 * n * (sizeof(IntSet) + IntSet_words_for(n) * sizeof(uint64_t));
+	}
+	if ((nfa->pattern) != NULL) {
+		bytes += n * sizeof(int);
+	}
+	return bytes;
+}
+
+//Bytes held by the given DFA
+static size_t dfaBytes(const DFA* dfa) {
+	int n = (dfa->numStates);
+	size_t bytes = sizeof(DFA) + n * sizeof(bool) + (size_t)n * (dfa->numClasses) * (dfa->width);
+	if ((dfa->numMatches) != NULL) {
+		bytes += n * (sizeof(int) + sizeof(int*)) + Arena_get_size(dfa->arena);
+	}
+	if ((dfa->accelOf) != NULL) {
+		bytes += n * sizeof(int);
+		for (int i = 0; i < n; i++) {
+			bytes += ((dfa->accelOf)[i] >= 0) ? sizeof(Accel) : 0;
+		}
+	}
+	return bytes;
+}
+
+//Contents of the file at path as a NUL-terminated string, or NULL; NUL bytes become spaces
+static char* readInput(const char* path, size_t* len) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) {
+		return NULL;
+	}
+	size_t cap = 1 << 20;
+	char* input = (char*)malloc(cap + 1);
+	size_t n = 0;
+	size_t got;
+	while ((got = fread(input + n, 1, cap - n, file)) > 0) {
+		n += got;
+		if (n == cap) {
+			cap *= 2;
+			input = (char*)realloc(input, cap + 1);
+		}
+	}
+	fclose(file);
+	for (size_t i = 0; i < n; i++) {
+		if (input[i] == '\0') {
+			input[i] = ' ';
+		}
+	}
+	input[n] = '\0';
+	*len = n;
+	return input;
+}
+
+//Shortest of reps runs of DFA_execute, or of NFA_execute if dfa is NULL
+static double bestScan(const DFA* dfa, const NFA* nfa, const char* input, int reps, bool* accepted) {
+	double best = 0;
+	for (int r = 0; r < reps; r++) {
+		double t0 = now();
+		*accepted = (dfa != NULL) ? DFA_execute(dfa, input) : NFA_execute(nfa, input);
+		double t = now() - t0;
+		best = (r == 0 || t < best) ? t : best;
+	}
+	return best;
+}
+
+//One report line for the NFA of the given family and size, scanned over input
+static void reportCase(const char* family, int size, NFA* nfa, const char* input, size_t len, const char* source, int reps) {
+	double t0 = now();
+	NFA_compress(nfa);
+	double compress = now() - t0;
+	t0 = now();
+	DFA* dfa = subsetConstruct(nfa);
+	double construct = now() - t0;
+	bool nfaAccepts = false;
+	bool dfaAccepts = false;
+	double nfaScan = bestScan(NULL, nfa, input, reps, &nfaAccepts);
+	double dfaScan = bestScan(dfa, NULL, input, reps, &dfaAccepts);
+	printf("{\"family\":\"%s\",\"size\":%d,\"input\":\"%s\",\"input_bytes\":%zu,"
+		"\"nfa_states\":%d,\"nfa_edges\":%d,\"nfa_bytes\":%zu,\"bit_parallel\":%s,\"compress_s\":%.6f,\"nfa_execute_mbps\":%.1f,"
+		"\"subset_construct_s\":%.6f,\"dfa_states\":%d,\"dfa_width\":%d,\"dfa_classes\":%d,\"dfa_bytes\":%zu,\"dfa_execute_mbps\":%.1f,"
+		"\"accepted\":%s,\"mismatch\":%s}\n",
+		family, size, source, len, NFA_get_size(nfa), (nfa->numEdges), nfaBytes(nfa), (nfa->bits) != NULL ? "true" : "false",
+		compress, len / nfaScan / 1e6, construct, DFA_get_size(dfa), (dfa->width), (dfa->numClasses), dfaBytes(dfa),
+		len / dfaScan / 1e6, dfaAccepts ? "true" : "false", nfaAccepts == dfaAccepts ? "false" : "true");
+	fflush(stdout);
+	DFA_free(dfa);
+	NFA_free(nfa);
+}
+
+/*
+* Run the regression report on len bytes of generated input per case, or,
+* for the families over lowercase text, on the text in the file at path if
+* path is not NULL. Returns false if the file cannot be read.
+*/
+static bool report(size_t len, const char* path, int reps) {
+	size_t textLen = len;
+	char* text = (path != NULL) ? readInput(path, &textLen) : randomInput(len, "abcdefghijklmnopqrstuvwxyz ", 43);
+	if (text == NULL) {
+		fprintf(stderr, "bench: cannot read %s\n", path);
+		return false;
+	}
+	const char* source = (path != NULL) ? "replay" : "random";
+	char* abc = randomInput(len, "abc", 47);
+	char* binary = randomInput(len, "01", 53);
+	for (int n = 16; n <= 64; n *= 2) {
+		reportCase("random", n, randomNFA(n, n), abc, len, "random", reps);
+	}
+	for (int k = 8; k <= 16; k += 4) {
+		reportCase("kth_from_last", k, kthFromLast(k), binary, len, "random", reps);
+	}
+	for (int n = 20; n <= 2000; n *= 10) {
+		reportCase("literal", n, endsWithLiteral(n, n), text, textLen, source, reps);
+	}
+	for (int n = 10; n <= 40; n *= 4) {
+		char* pattern = wordsPattern(n, n);
+		reportCase("words", n, Regex_compile(pattern, NULL), text, textLen, source, reps);
+		free(pattern);
+	}
+	free(binary);
+	free(abc);
+	free(text);
+	return true;
+}
+
+/*
+* With no arguments, print readable timings of every benchmark. With
+* --report, print the regression report instead, on --size MB of input per
+* case (default 4), replaying the text of --input FILE for the families
+* over lowercase text, and keeping the best of --reps scans (default 3).
+*/
+int main(int argc, char** argv) {
+	bool reportOnly = false;
+	size_t len = 4 << 20;
+	const char* path = NULL;
+	int reps = 3;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--report") == 0) {
+			reportOnly = true;
+		}
+		else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+			len = (size_t)atoi(argv[++i]) << 20;
+		}
+		else if (strcmp(argv[i], "--input") == 0 && i + 1 < argc) {
+			path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+			reps = atoi(argv[++i]);
+		}
+		else {
+			fprintf(stderr, "usage: %s [--report [--size MB] [--input FILE] [--reps N]]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (reportOnly) {
+		return (len > 0 && reps > 0 && report(len, path, reps)) ? 0 : 1;
+	}
+	benchSubsetConstruct();
+	benchWideNFA();
+	benchScan();
+	benchMinimize();
+	benchStream();
+	benchAccelerate();
+	benchBatch();
+	benchInterleave();
+	benchNFAExecute();
+	benchLazyDFA();
+	benchRegex();
+	benchUTF8();
+	benchSparseNFA();
+	benchParallelSubset();
+	benchBitNFA();
+	benchProduct();
+	benchEquivalence();
+	benchStaticDFA();
+	benchCodegen();
+	benchMultiPattern();
+	benchSearch();
+	benchMap();
+	return 0;
+}
@@ -0,0 +1,219 @@
+/*
+* Author: Peter Hess
+* File: codegen.c
+*
+* Compiling a DFA into C source. Both forms of matcher share the DFA's
+* map from all 256 bytes to classes of symbols, so NUL and bytes >= 128
+* are read like any other. The table form stores HALT as the all-ones id
+* of its width, as the DFA does; the switch form sends HALT classes to the
+* default case.
+* DFA_generate_static writes a StaticDFA instead, whose rows list only the
+* transitions that exist by designated initializers.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include "dfa.h"
+#include "StaticDFA.h"
+#include "codegen.h"
+
+#define HALT -1
+
+//True if name can be used as a C identifier
+static bool codegenIdentifier(const char* name) {
+	if (!isalpha((unsigned char)name[0]) && name[0] != '_') {
+		return false;
+	}
+	for (int i = 1; name[i] != '\0'; i++) {
+		if (!isalnum((unsigned char)name[i]) && name[i] != '_') {
+			return false;
+		}
+	}
+	return true;
+}
+
+//Write the map from each byte to its class
+static void codegenClasses(const DFA* dfa, const char* name, FILE* out) {
+	fprintf(out, "static const uint8_t %s_classes[%d] = {", name, sigma);
+	for (int b = 0; b < sigma; b++) {
+		fprintf(out, "%s%d", (b == 0) ? "\n\t" : (b % 16 == 0) ? ",\n\t" : ", ", (dfa->classes)[b]);
+	}
+	fprintf(out, "\n};\n\n");
+}
+
+//Write name_match as a loop over a static const table of the DFA's width
+static void codegenTable(const DFA* dfa, const char* name, FILE* out) {
+	int n = (dfa->numStates);
+	int k = (dfa->numClasses);
+	const char* type = ((dfa->width) == 1) ? "uint8_t" : ((dfa->width) == 2) ? "uint16_t" : "int32_t";
+	const char* halt = ((dfa->width) == 1) ? "UINT8_MAX" : ((dfa->width) == 2) ? "UINT16_MAX" : "-1";
+	fprintf(out, "static const %s %s_table[%d][%d] = {\n", type, name, n, k);
+	for (int q = 0; q < n; q++) {
+		fprintf(out, "\t{ ");
+		for (int c = 0; c < k; c++) {
+			int dst = DFA_get_class_transition(dfa, q, c);
+			if (dst == HALT) {
+				fprintf(out, "%s%s", halt, (c + 1 < k) ? ", " : " ");
+			}
+			else {
+				fprintf(out, "%d%s", dst, (c + 1 < k) ? ", " : " ");
+			}
+		}
+		fprintf(out, "},\n");
+	}
+	fprintf(out, "};\n\n");
+	fprintf(out, "static const bool %s_accept[%d] = {", name, n);
+	for (int q = 0; q < n; q++) {
+		fprintf(out, "%s%d", (q == 0) ? "\n\t" : (q % 32 == 0) ? ",\n\t" : ", ", DFA_get_accepting(dfa, q));
+	}
+	fprintf(out, "\n};\n\n");
+	fprintf(out, "bool %s_match(const uint8_t* input, size_t len) {\n", name);
+	fprintf(out, "\t%s state = 0;\n", type);
+	fprintf(out, "\tfor (size_t i = 0; i < len; i++) {\n");
+	fprintf(out, "\t\tstate = %s_table[state][%s_classes[input[i]]];\n", name, name);
+	fprintf(out, "\t\tif (state == (%s)%s) {\n", type, halt);
+	fprintf(out, "\t\t\treturn false;\n");
+	fprintf(out, "\t\t}\n");
+	fprintf(out, "\t}\n");
+	fprintf(out, "\treturn %s_accept[state];\n", name);
+	fprintf(out, "}\n\n");
+}
+
+//Write name_match as one label per state, each a switch on the class of the next byte
+static void codegenSwitch(const DFA* dfa, const char* name, FILE* out) {
+	int n = (dfa->numStates);
+	int k = (dfa->numClasses);
+	bool* target = (bool*)calloc(n, sizeof(bool));		//States some transition leads to, which need a label
+	for (int q = 0; q < n; q++) {
+		for (int c = 0; c < k; c++) {
+			int dst = DFA_get_class_transition(dfa, q, c);
+			if (dst != HALT) {
+				target[dst] = true;
+			}
+		}
+	}
+	bool* done = (bool*)malloc(k * sizeof(bool));
+	fprintf(out, "bool %s_match(const uint8_t* input, size_t len) {\n", name);
+	fprintf(out, "\tconst uint8_t* end = input + len;\n");
+	for (int q = 0; q < n; q++) {
+		if (target[q]) {
+			fprintf(out, "s%d:\n", q);
+		}
+		fprintf(out, "\tif (input == end) {\n");
+		fprintf(out, "\t\treturn %s;\n", DFA_get_accepting(dfa, q) ? "true" : "false");
+		fprintf(out, "\t}\n");
+		fprintf(out, "\tswitch (%s_classes[*input++]) {\n", name);
+		memset(done, 0, k * sizeof(bool));
+		for (int c = 0; c < k; c++) {						//One case list per next state, so each goto is written once
+			int dst = DFA_get_class_transition(dfa, q, c);
+			if (done[c] || dst == HALT) {
+				continue;
+			}
+			for (int d = c; d < k; d++) {
+				if (!done[d] && DFA_get_class_transition(dfa, q, d) == dst) {
+					fprintf(out, "\tcase %d:\n", d);
+					done[d] = true;
+				}
+			}
+			fprintf(out, "\t\tgoto s%d;\n", dst);
+		}
+		fprintf(out, "\tdefault:\n");
+		fprintf(out, "\t\treturn false;\n");
+		fprintf(out, "\t}\n");
+	}
+	fprintf(out, "}\n\n");
+	free(done);
+	free(target);
+}
+
+/**
+* Write to the file at path a C source file that defines name and
+* name_match, which accept exactly the strings the given DFA accepts.
+* Returns false if name is not a C identifier or the file could not be
+* written.
+*/
+bool DFA_generate_c(const DFA* dfa, const char* name, CodegenStyle style, const char* path) {
+	if (!codegenIdentifier(name)) {
+		return false;
+	}
+	FILE* out = fopen(path, "w");
+	if (out == NULL) {
+		return false;
+	}
+	fprintf(out, "/*\n* Generated by DFA_generate_c: %d states, %d classes of symbols, %s.\n*/\n\n",
+		DFA_get_size(dfa), (dfa->numClasses), (style == CODEGEN_SWITCH) ? "direct-coded" : "table-driven");
+	fprintf(out, "#include <stdbool.h>\n#include <stddef.h>\n#include <stdint.h>\n#include <string.h>\n\n");
+	if ((dfa->numStates) == 0) {						//No start state: nothing is accepted
+		fprintf(out, "bool %s_match(const uint8_t* input, size_t len) {\n\t(void)input;\n\t(void)len;\n\treturn false;\n}\n\n", name);
+	}
+	else {
+		codegenClasses(dfa, name, out);
+		if (style == CODEGEN_SWITCH) {
+			codegenSwitch(dfa, name, out);
+		}
+		else {
+			codegenTable(dfa, name, out);
+		}
+	}
+	fprintf(out, "bool %s(const char* input) {\n", name);
+	fprintf(out, "\treturn %s_match((const uint8_t*)input, strlen(input));\n", name);
+	fprintf(out, "}\n");
+	bool ok = !ferror(out);
+	return (fclose(out) == 0) && ok;
+}
+
+//Write byte as a designator of a table row: a character literal if it is printable, else its value
+static void codegenDesignator(int byte, FILE* out) {
+	if (byte < 128 && isprint(byte) && byte != '\'' && byte != '\\') {
+		fprintf(out, "['%c']", byte);
+	}
+	else {
+		fprintf(out, "[%d]", byte);
+	}
+}
+
+/**
+* Write to the file at path a C header that defines a StaticDFA called
+* name with the states, transitions and accepting states of the given DFA.
+* Returns false if name is not a C identifier, the DFA has no states or
+* more than STATIC_DFA_MAX_STATES, or the file could not be written.
+*/
+bool DFA_generate_static(const DFA* dfa, const char* name, const char* path) {
+	int n = (dfa->numStates);
+	if (!codegenIdentifier(name) || n == 0 || n > STATIC_DFA_MAX_STATES) {
+		return false;
+	}
+	FILE* out = fopen(path, "w");
+	if (out == NULL) {
+		return false;
+	}
+	fprintf(out, "/*\n* Generated by DFA_generate_static: %d states.\n*/\n\n", n);
+	fprintf(out, "#ifndef _%s_h\n#define _%s_h\n\n#include \"StaticDFA.h\"\n\n", name, name);
+	fprintf(out, "static const uint8_t %s_table[%d][256] = {\n", name, n);
+	for (int q = 0; q < n; q++) {
+		fprintf(out, "\t[%d] = {", q);
+		int count = 0;
+		for (int sym = 0; sym < sigma; sym++) {				//Only the transitions that exist; the rest are 0
+			int dst = DFA_get_transition(dfa, q, (char)sym);
+			if (dst != HALT) {
+				fprintf(out, "%s", (count == 0) ? " " : (count % 8 == 0) ? ",\n\t\t" : ", ");
+				codegenDesignator(sym, out);
+				fprintf(out, " = %d", dst + 1);
+				count++;
+			}
+		}
+		fprintf(out, "%s},\n", (count == 0) ? " 0 " : " ");
+	}
+	fprintf(out, "};\n\n");
+	fprintf(out, "static const bool %s_accept[%d] = {", name, n);
+	for (int q = 0; q < n; q++) {
+		fprintf(out, "%s%s", (q == 0) ? "\n\t" : (q % 16 == 0) ? ",\n\t" : ", ", DFA_get_accepting(dfa, q) ? "true" : "false");
+	}
+	fprintf(out, "\n};\n\n");
+	fprintf(out, "static const StaticDFA %s = STATIC_DFA(%s_table, %s_accept);\n\n#endif\n", name, name, name);
+	bool ok = !ferror(out);
+	return (fclose(out) == 0) && ok;
+}
@@ -0,0 +1,50 @@
+/*
+* Author: Peter Hess
+* File: codegen.h
+*
+* Compiling a DFA into C source: a standalone matcher with the DFA built
+* in, for fixed rule sets that the compiler can then optimize and inline
+* into the program that uses them.
+*/
+
+#ifndef _codegen_h
+#define _codegen_h
+
+#include <stdbool.h>
+#include "dfa.h"
+
+/**
+* Form of the generated matcher: a direct-coded state machine, with one
+* label per state and a switch on the class of each byte that jumps to the
+* next state, or a loop over a static const transition table whose state
+* ids are the DFA's own width. Direct code avoids the table loads and
+* suits DFAs of up to a few thousand states; the table stays compact for
+* larger ones.
+*/
+typedef enum { CODEGEN_SWITCH, CODEGEN_TABLE } CodegenStyle;
+
+/**
+* Write to the file at path, replacing it, a C source file that defines
+*     bool name(const char* input);
+*     bool name_match(const uint8_t* input, size_t len);
+* which accept exactly the strings the given DFA accepts, as DFA_execute
+* and DFA_feed do: name reads input up to its NUL, and name_match reads
+* len bytes, in which NUL is an ordinary symbol. The file needs only the
+* C standard headers. Returns false if name is not a C identifier or the
+* file could not be written.
+*/
+extern bool DFA_generate_c(const DFA* dfa, const char* name, CodegenStyle style, const char* path);
+
+/**
+* Write to the file at path, replacing it, a C header that defines
+*     static const StaticDFA name;
+* (see StaticDFA.h) with the states, transitions and accepting states of
+* the given DFA, so that a DFA built by a generator program, say from a
+* regular expression, is compiled into the program that includes the
+* header as a read-only table. Returns false if name is not a C
+* identifier, the DFA has no states or more than STATIC_DFA_MAX_STATES,
+* or the file could not be written.
+*/
+extern bool DFA_generate_static(const DFA* dfa, const char* name, const char* path);
+
+#endif
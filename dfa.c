@@ -9,45 +9,110 @@
 #include <stdlib.h>
 #include <stdio.h> 
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
 #include "dfa.h"
+#include "ByteClass.h"
+#include "accel.h"
 
 #define HALT -1
-#define sigma 128 
+
+//Read entry i of the table, decoding the all-ones value as HALT
+static int DFA_table_get(const DFA* dfa, size_t i) {
+	switch (dfa->width) {
+	case 1:
+		return ((uint8_t*)(dfa->tTable))[i] == UINT8_MAX ? HALT : ((uint8_t*)(dfa->tTable))[i];
+	case 2:
+		return ((uint16_t*)(dfa->tTable))[i] == UINT16_MAX ? HALT : ((uint16_t*)(dfa->tTable))[i];
+	default:
+		return (int)((int32_t*)(dfa->tTable))[i];			//HALT is -1, which is already all ones
+	}
+}
+
+//Write entry i of the table; HALT (-1) truncates to all ones
+static void DFA_table_set(DFA* dfa, size_t i, int dst) {
+	switch (dfa->width) {
+	case 1:
+		((uint8_t*)(dfa->tTable))[i] = (uint8_t)dst;
+		break;
+	case 2:
+		((uint16_t*)(dfa->tTable))[i] = (uint16_t)dst;
+		break;
+	default:
+		((int32_t*)(dfa->tTable))[i] = dst;
+		break;
+	}
+}
 
 /**
-* Allocate and return a new DFA containing the given number of states.
+* Allocate and return a new DFA containing the given number of states, whose
+* input symbols are grouped into nclasses classes by the classes map.
+* Transitions are then the same for every symbol of a class.
 */
-DFA* DFA_new(int n) {
+DFA* DFA_new_classes(int n, const uint8_t* classes, int nclasses) {
 
 	DFA* dfa = (DFA*)malloc(sizeof(DFA));
 	(dfa->numStates) = n;
-	(dfa->curr) = 0;
+	(dfa->numClasses) = nclasses;
+	memcpy(dfa->classes, classes, sigma);
+
+	if (n < UINT8_MAX) {								//Narrowest state id that still leaves the all-ones value for HALT
+		(dfa->width) = 1;
+	}
+	else if (n < UINT16_MAX) {
+		(dfa->width) = 2;
+	}
+	else {
+		(dfa->width) = 4;
+	}
 
 	(dfa->accept) = (bool*)malloc(n * sizeof(bool));					//accept is an array of n booleans
-	(dfa->tTable) = (int**)malloc(n * sizeof(int*));					//tTable is an n by 128 dimensional array
+	(dfa->tTable) = malloc((size_t)n * nclasses * (dfa->width));		//tTable is a single n by nclasses block
+	memset(dfa->tTable, 0xff, (size_t)n * nclasses * (dfa->width));	//Set all transitions to HALT, by default
 
 	for (int i = 0; i < n; i++) {
-
-		(dfa->tTable)[i] = (int *)malloc(sigma * sizeof(int));		//Each row of tTable will be an array of 128 ints
 		(dfa->accept)[i] = false;									//Initially set all states to non-accepting
-
-		for (int j = 0; j < sigma; j++) {
-			(dfa->tTable)[i][j] = HALT;								//Set all transitions to HALT, by default
-		}
-
 	}
+	(dfa->numMatches) = NULL;										//Pattern ids are only allocated once set
+	(dfa->matches) = NULL;
+	(dfa->arena) = NULL;
+	(dfa->accelOf) = NULL;											//Only set by DFA_accelerate
+	(dfa->accel) = NULL;
+	(dfa->mapping) = NULL;
 
 	return dfa;
 }
 
+/**
+* Allocate and return a new DFA containing the given number of states.
+*/
+DFA* DFA_new(int n) {
+	uint8_t classes[sigma];
+	int nclasses = ByteClass_ascii(classes);		//One column per ASCII symbol and one for the bytes above, until split or compressed
+	return DFA_new_classes(n, classes, nclasses);
+}
+
 /**
 * Free the given DFA.
 */
 void DFA_free(DFA* dfa) {
-	free(dfa->accept);
-	for (int i = 0; i < DFA_get_size(dfa); i++) {
-		free((dfa->tTable)[i]);
+	if ((dfa->mapping) != NULL) {									//Only the index arrays were allocated by DFA_map
+		free(dfa->matches);
+		free(dfa->numMatches);
+		free(dfa->accel);
+		munmap(dfa->mapping, dfa->mappedSize);
+		free(dfa);
+		return;
 	}
+	if ((dfa->matches) != NULL) {
+		Arena_free(dfa->arena);
+		free(dfa->matches);
+		free(dfa->numMatches);
+	}
+	free(dfa->accelOf);
+	free(dfa->accel);
+	free(dfa->accept);
 	free(dfa->tTable);
 	free(dfa);
 }
@@ -55,16 +120,58 @@ void DFA_free(DFA* dfa) {
 /**
 * Return the number of states in the given DFA.
 */
-int DFA_get_size(DFA* dfa) {
+int DFA_get_size(const DFA* dfa) {
 	return (dfa->numStates);
 }
 
+//Rebuild the table with one column per class of the given map.
+//Symbols that share a class in the new map must already lead to the same states.
+static void DFA_set_classes(DFA* dfa, const uint8_t* classes, int nclasses) {
+	int reps[sigma];
+	ByteClass_representatives(classes, nclasses, reps);
+
+	void* oldTable = (dfa->tTable);
+	int oldClasses = (dfa->numClasses);
+	uint8_t oldMap[sigma];
+	memcpy(oldMap, dfa->classes, sigma);
+
+	(dfa->tTable) = malloc((size_t)(dfa->numStates) * nclasses * (dfa->width));
+	for (int i = 0; i < (dfa->numStates); i++) {
+		for (int c = 0; c < nclasses; c++) {
+			size_t from = (size_t)i * oldClasses + oldMap[reps[c]];
+			memcpy((char*)(dfa->tTable) + ((size_t)i * nclasses + c) * (dfa->width),
+				(char*)oldTable + from * (dfa->width), (dfa->width));
+		}
+	}
+	free(oldTable);
+	(dfa->numClasses) = nclasses;
+	memcpy(dfa->classes, classes, sigma);
+}
+
+//Forget how to skip ahead in the DFA's states, as a transition is about to change
+static void DFA_drop_accel(DFA* dfa) {
+	free(dfa->accelOf);
+	free(dfa->accel);
+	(dfa->accelOf) = NULL;
+	(dfa->accel) = NULL;
+}
+
 /**
 * Return the state specified by the given DFA's transition function from
 * state src on input symbol sym.
 */
-int DFA_get_transition(DFA* dfa, int src, char sym) {
-	return (dfa->tTable)[src][(int)sym];
+int DFA_get_transition(const DFA* dfa, int src, char sym) {
+	return DFA_table_get(dfa, (size_t)src * (dfa->numClasses) + (dfa->classes)[(uint8_t)sym]);
+}
+
+//True if no other symbol shares sym's class
+static bool DFA_alone_in_class(const DFA* dfa, int sym) {
+	for (int i = 0; i < sigma; i++) {
+		if (i != sym && (dfa->classes)[i] == (dfa->classes)[sym]) {
+			return false;
+		}
+	}
+	return true;
 }
 
 /**
@@ -72,7 +179,35 @@ int DFA_get_transition(DFA* dfa, int src, char sym) {
 * sym to be the state dst.
 */
 void DFA_set_transition(DFA* dfa, int src, char sym, int dst) {
-	(dfa->tTable)[src][(int)sym] = dst;
+	if ((dfa->accelOf) != NULL) {
+		DFA_drop_accel(dfa);
+	}
+	if (DFA_get_transition(dfa, src, sym) != dst && !DFA_alone_in_class(dfa, (uint8_t)sym)) {	//sym needs its own column
+		uint8_t classes[sigma];
+		memcpy(classes, dfa->classes, sigma);
+		classes[(uint8_t)sym] = (uint8_t)(dfa->numClasses);
+		DFA_set_classes(dfa, classes, (dfa->numClasses) + 1);	//The new column starts as a copy of the old class's
+	}
+	DFA_table_set(dfa, (size_t)src * (dfa->numClasses) + (dfa->classes)[(uint8_t)sym], dst);
+}
+
+/**
+* Return the state the given DFA goes to from state src on any symbol of
+* class cls.
+*/
+int DFA_get_class_transition(const DFA* dfa, int src, int cls) {
+	return DFA_table_get(dfa, (size_t)src * (dfa->numClasses) + cls);
+}
+
+/**
+* Set the transition of the given DFA from state src on every symbol of
+* class cls to be the state dst.
+*/
+void DFA_set_class_transition(DFA* dfa, int src, int cls, int dst) {
+	if ((dfa->accelOf) != NULL) {
+		DFA_drop_accel(dfa);
+	}
+	DFA_table_set(dfa, (size_t)src * (dfa->numClasses) + cls, dst);
 }
 
 /**
@@ -82,7 +217,7 @@ void DFA_set_transition(DFA* dfa, int src, char sym, int dst) {
 */
 void DFA_set_transition_str(DFA* dfa, int src, char *str, int dst) {
 	for (int i = 0; str[i] != '\0'; i++) {
-		(dfa->tTable)[src][(int)str[i]] = dst;
+		DFA_set_transition(dfa, src, str[i], dst);
 	}
 }
 
@@ -91,8 +226,8 @@ void DFA_set_transition_str(DFA* dfa, int src, char *str, int dst) {
 * Another shortcut method.
 */
 void DFA_set_transition_all(DFA* dfa, int src, int dst) {
-	for (int i = 0; i < sigma; i++) {
-		(dfa->tTable)[src][i] = dst;
+	for (int c = 0; c < (dfa->numClasses); c++) {		//Every symbol goes to dst, so the classes need not split
+		DFA_set_class_transition(dfa, src, c, dst);
 	}
 }
 
@@ -106,37 +241,307 @@ void DFA_set_accepting(DFA* dfa, int state, bool value) {
 /**
 * Return true if the given DFA's state is an accepting state.
 */
-bool DFA_get_accepting(DFA* dfa, int state) {
+bool DFA_get_accepting(const DFA* dfa, int state) {
 	return (dfa->accept)[state];
 }
 
 /**
-* Run the given DFA on the given input string, and return true if it accepts
-* the input, otherwise false.
+* Make the given DFA's state report the n pattern ids in ids, which must be
+* sorted and distinct, when the input ends there.
+*/
+void DFA_set_matches(DFA* dfa, int state, const int* ids, int n) {
+	if ((dfa->matches) == NULL) {
+		(dfa->numMatches) = (int*)calloc(dfa->numStates, sizeof(int));
+		(dfa->matches) = (int**)calloc(dfa->numStates, sizeof(int*));
+		(dfa->arena) = Arena_new(4096);
+	}
+	(dfa->matches)[state] = (n > 0) ? (int*)Arena_alloc(dfa->arena, n * sizeof(int)) : NULL;	//A replaced list stays in the arena
+	if (n > 0) {
+		memcpy((dfa->matches)[state], ids, n * sizeof(int));
+	}
+	(dfa->numMatches)[state] = n;
+	(dfa->accept)[state] = (n > 0);
+}
+
+/**
+* Return the number of patterns the given DFA's state reports, storing a
+* pointer to their sorted ids in *ids.
+*/
+int DFA_get_matches(const DFA* dfa, int state, const int** ids) {
+	static const int pattern0[1] = { 0 };
+	if (!(dfa->accept)[state]) {
+		*ids = NULL;
+		return 0;
+	}
+	if ((dfa->matches) == NULL || (dfa->numMatches)[state] == 0) {	//Accepting, but set with DFA_set_accepting
+		*ids = pattern0;
+		return 1;
+	}
+	*ids = (dfa->matches)[state];
+	return (dfa->numMatches)[state];
+}
+
+//Scan loop over a table of the given state id type, from state curr over len bytes of input.
+//Returns the state reached, or HALT if some byte had no transition.
+#define DFA_SCAN(type, halt)											\
+	static int DFA_scan_##type(const DFA* dfa, int curr, const uint8_t* input, size_t len) {	\
+		const type* table = (const type*)(dfa->tTable);					\
+		const uint8_t* classes = (dfa->classes);						\
+		size_t stride = (dfa->numClasses);								\
+		type state = (type)curr;										\
+		for (size_t i = 0; i < len; i++) {								\
+			state = table[state * stride + classes[input[i]]];			\
+			if (state == halt) {										\
+				return HALT;		/*Reject if no transition is available*/	\
+			}															\
+		}																\
+		return state;													\
+	}
+
+DFA_SCAN(uint8_t, UINT8_MAX)
+DFA_SCAN(uint16_t, UINT16_MAX)
+DFA_SCAN(int32_t, HALT)
+
+//Scan loop like DFA_SCAN for an accelerated DFA: whenever a byte leads from a state back to
+//itself, and that state is accelerated, every following byte that stays in it is skipped at once
+#define DFA_SCAN_ACCEL(type, halt)										\
+	static int DFA_scan_accel_##type(const DFA* dfa, int curr, const uint8_t* input, size_t len) {	\
+		const type* table = (const type*)(dfa->tTable);					\
+		const uint8_t* classes = (dfa->classes);						\
+		const int* accelOf = (dfa->accelOf);							\
+		size_t stride = (dfa->numClasses);								\
+		type state = (type)curr;										\
+		for (size_t i = 0; i < len; i++) {								\
+			type next = table[state * stride + classes[input[i]]];		\
+			if (next == halt) {											\
+				return HALT;		/*Reject if no transition is available*/	\
+			}															\
+			if (next == state && accelOf[state] >= 0) {				\
+				i += Accel_skip(&(dfa->accel)[accelOf[state]], input + i + 1, len - i - 1);	\
+			}															\
+			state = next;												\
+		}																\
+		return state;													\
+	}
+
+DFA_SCAN_ACCEL(uint8_t, UINT8_MAX)
+DFA_SCAN_ACCEL(uint16_t, UINT16_MAX)
+DFA_SCAN_ACCEL(int32_t, HALT)
+
+//Report the patterns of the given state, which must be accepting, as ending at end
+static size_t DFA_report(const DFA* dfa, int state, size_t end, void(*report)(void*, int, size_t), void* arg) {
+	const int* ids;
+	int n = DFA_get_matches(dfa, state, &ids);
+	for (int i = 0; i < n; i++) {
+		report(arg, ids[i], end);
+	}
+	return n;
+}
+
+//Scan loop like DFA_SCAN that also reports the patterns of every accepting state reached
+#define DFA_MATCH_ALL(type, halt)										\
+	static size_t DFA_match_all_##type(const DFA* dfa, const uint8_t* input, size_t len,	\
+		void(*report)(void*, int, size_t), void* arg) {					\
+		const type* table = (const type*)(dfa->tTable);					\
+		const uint8_t* classes = (dfa->classes);						\
+		const bool* accept = (dfa->accept);								\
+		size_t stride = (dfa->numClasses);								\
+		type state = 0;													\
+		size_t count = accept[0] ? DFA_report(dfa, 0, 0, report, arg) : 0;	\
+		for (size_t i = 0; i < len; i++) {								\
+			state = table[state * stride + classes[input[i]]];			\
+			if (state == halt) {										\
+				break;				/*No more matches are possible*/	\
+			}															\
+			if (accept[state]) {										\
+				count += DFA_report(dfa, state, i + 1, report, arg);	\
+			}															\
+		}																\
+		return count;													\
+	}
+
+DFA_MATCH_ALL(uint8_t, UINT8_MAX)
+DFA_MATCH_ALL(uint16_t, UINT16_MAX)
+DFA_MATCH_ALL(int32_t, HALT)
+
+//Run the DFA over len bytes of input from state curr, returning the state reached or HALT
+static int DFA_scan(const DFA* dfa, int curr, const uint8_t* input, size_t len) {
+	if ((dfa->accelOf) != NULL) {
+		switch (dfa->width) {
+		case 1:
+			return DFA_scan_accel_uint8_t(dfa, curr, input, len);
+		case 2:
+			return DFA_scan_accel_uint16_t(dfa, curr, input, len);
+		default:
+			return DFA_scan_accel_int32_t(dfa, curr, input, len);
+		}
+	}
+	switch (dfa->width) {
+	case 1:
+		return DFA_scan_uint8_t(dfa, curr, input, len);
+	case 2:
+		return DFA_scan_uint16_t(dfa, curr, input, len);
+	default:
+		return DFA_scan_int32_t(dfa, curr, input, len);
+	}
+}
+
+//Hash of the column of the table used by sym
+static uint64_t DFA_column_hash(const void* ctx, int sym) {
+	const DFA* dfa = (const DFA*)ctx;
+	uint64_t h = 0;
+	for (int i = 0; i < (dfa->numStates); i++) {
+		h = (h ^ (uint64_t)(DFA_get_transition(dfa, i, (char)sym) + 1)) * 0x9e3779b97f4a7c15ULL;
+	}
+	return h;
+}
+
+//True if sym1 and sym2 lead to the same state from every state
+static bool DFA_same_column(const void* ctx, int sym1, int sym2) {
+	const DFA* dfa = (const DFA*)ctx;
+	for (int i = 0; i < (dfa->numStates); i++) {
+		if (DFA_get_transition(dfa, i, (char)sym1) != DFA_get_transition(dfa, i, (char)sym2)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+* Compress the given DFA's table by merging input symbols whose columns are
+* identical into one class, and return the number of classes. Setting a
+* transition afterwards gives its symbol a column of its own if it needs one.
 */
-bool DFA_execute(DFA* dfa, char *input) {
-	int next;
-	for (int i = 0; input[i] != '\0'; i++) {
+int DFA_compress(DFA* dfa) {
+	uint8_t classes[sigma];
+	int nclasses = ByteClass_partition(classes, DFA_column_hash, DFA_same_column, dfa);
+	if (nclasses < (dfa->numClasses)) {
+		DFA_set_classes(dfa, classes, nclasses);
+	}
+	return (dfa->numClasses);
+}
 
-		next = DFA_get_transition(dfa, dfa->curr, input[i]); //Get transition on input char
-		if (next == HALT) {
-			return false;		//Reject if no transition is available
+/**
+* Find the states of the given DFA that are left by at most maxEscapes
+* symbols, looping back to themselves on all the others, and record
+* those escape symbols for DFA_execute and DFA_feed. Returns the number of
+* states accelerated.
+*/
+int DFA_accelerate(DFA* dfa, int maxEscapes) {
+	DFA_drop_accel(dfa);
+	if (maxEscapes < 0) {
+		return 0;
+	}
+	int* accelOf = (int*)malloc(((dfa->numStates) + 1) * sizeof(int));
+	Accel* accel = (Accel*)malloc(((dfa->numStates) + 1) * sizeof(Accel));
+	int count = 0;
+	for (int q = 0; q < (dfa->numStates); q++) {
+		bool leaves[sigma];
+		int nleaves = 0;
+		for (int sym = 0; sym < sigma; sym++) {
+			leaves[sym] = DFA_get_class_transition(dfa, q, (dfa->classes)[sym]) != q;
+			nleaves += leaves[sym];
+		}
+		if (nleaves <= maxEscapes && nleaves < sigma) {
+			Accel_init(&accel[count], leaves);
+			accelOf[q] = count++;
 		}
 		else {
-			(dfa->curr) = next; //Set next as current state
+			accelOf[q] = -1;
 		}
 	}
+	if (count == 0) {
+		free(accelOf);
+		free(accel);
+		return 0;
+	}
+	(dfa->accelOf) = accelOf;
+	(dfa->accel) = (Accel*)realloc(accel, count * sizeof(Accel));
+	return count;
+}
 
-	if ((dfa->accept)[dfa->curr] == true) { //Accept string if in accepting state
-		return true;
+/**
+* Run the given DFA on the given input string, and return true if it accepts
+* the input, otherwise false.
+*/
+bool DFA_execute(const DFA* dfa, const char *input) {
+	if ((dfa->numStates) == 0) {					//No start state: nothing is accepted
+		return false;
 	}
-	return false;
+	int state = DFA_scan(dfa, 0, (const uint8_t*)input, strlen(input));
+	return state != HALT && (dfa->accept)[state];	//Accept string if in accepting state
+}
+
+/**
+* Run the given DFA over len bytes of input and call report(arg, pattern,
+* end) for every pattern reported by every accepting state it passes
+* through, where end is the number of bytes read so far. Returns the
+* number of reports made.
+*/
+size_t DFA_match_all(const DFA* dfa, const uint8_t* input, size_t len,
+	void(*report)(void* arg, int pattern, size_t end), void* arg) {
+	if ((dfa->numStates) == 0) {
+		return 0;
+	}
+	switch (dfa->width) {
+	case 1:
+		return DFA_match_all_uint8_t(dfa, input, len, report, arg);
+	case 2:
+		return DFA_match_all_uint16_t(dfa, input, len, report, arg);
+	default:
+		return DFA_match_all_int32_t(dfa, input, len, report, arg);
+	}
+}
+
+/**
+* Allocate and return a new match context for the given DFA, positioned at
+* the start of an input.
+*/
+DFA_Context* DFA_context_new(const DFA* dfa) {
+	DFA_Context* ctx = (DFA_Context*)malloc(sizeof(DFA_Context));
+	(ctx->dfa) = dfa;
+	DFA_context_reset(ctx);
+	return ctx;
+}
+
+/**
+* Free the given match context (but not its DFA).
+*/
+void DFA_context_free(DFA_Context* ctx) {
+	free(ctx);
+}
+
+/**
+* Return the given match context to the start of a new input.
+*/
+void DFA_context_reset(DFA_Context* ctx) {
+	(ctx->state) = ((ctx->dfa->numStates) > 0) ? 0 : HALT;	//A DFA with no states halts at once
+}
+
+/**
+* Advance the given match context over the next len bytes of its input.
+* Returns false once the input can no longer be accepted, after which
+* further calls do nothing.
+*/
+bool DFA_feed(DFA_Context* ctx, const uint8_t* buf, size_t len) {
+	if ((ctx->state) != HALT) {
+		(ctx->state) = DFA_scan(ctx->dfa, ctx->state, buf, len);
+	}
+	return (ctx->state) != HALT;
+}
+
+/**
+* Return true if the input fed to the given match context so far is
+* accepted by its DFA. The context is unchanged, so more input may follow.
+*/
+bool DFA_finish(DFA_Context* ctx) {
+	return (ctx->state) != HALT && (ctx->dfa->accept)[ctx->state];
 }
 
 /**
 * Print the given DFA to System.out.
 */
-void DFA_print(DFA* dfa) {
+void DFA_print(const DFA* dfa) {
 
 	printf("The set of states 0,...,%d.\n", DFA_get_size(dfa) - 1);
 	printf("The start state is 0.\n");
@@ -147,9 +552,12 @@ void DFA_print(DFA* dfa) {
 		printf("State: %d\t| ", n);
 		for (int i = 0; i < sigma; i++) {
 			int trans = DFA_get_transition(dfa, n, (char)i);
-			if (trans != HALT) {
+			if (trans != HALT && i < 128) {
 				printf("on \'%c\' goto %d \t| ", (char)i, trans);
 			}
+			else if (trans != HALT) {
+				printf("on \\x%02x goto %d \t| ", i, trans);
+			}
 		}
 		printf("halt on remaining inputs.\n");
 	}
@@ -162,4 +570,16 @@ void DFA_print(DFA* dfa) {
 		}
 	}
 	printf("}.\n");
+
+	if ((dfa->matches) != NULL) {									//Print pattern ids, if any were set
+		for (int i = 0; i < DFA_get_size(dfa); i++) {
+			if ((dfa->numMatches)[i] > 0) {
+				printf("State %d reports patterns", i);
+				for (int j = 0; j < (dfa->numMatches)[i]; j++) {
+					printf(" %d", (dfa->matches)[i][j]);
+				}
+				printf(".\n");
+			}
+		}
+	}
 }
\ No newline at end of file
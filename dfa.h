@@ -11,9 +11,13 @@
 #define _dfa_h
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "accel.h"
+#include "Arena.h"
 
-// Assume input is 7-bit US-ASCII characters
-#define sigma 128
+// Input symbols are bytes, 0 to 255; UTF-8 text is matched a byte at a time
+#define sigma 256
 
 /**
 * The data structure used to represent a deterministic finite automaton.
@@ -24,16 +28,44 @@
 */
 typedef struct {
 	int numStates;
-	int curr;
 	bool* accept;
-	int** tTable;
+	int width;			//Bytes per state id in tTable: 1, 2 or 4, the smallest that fits numStates
+	int numClasses;		//Number of columns in tTable
+	uint8_t classes[sigma];	//Column of tTable used for each input symbol
+	void* tTable;		//numStates by numClasses state ids in one row-major block; all ones means HALT
+	int* numMatches;	//Number of patterns reported by each state, or NULL if every accepting state reports pattern 0
+	int** matches;		//Sorted pattern ids reported by each state, allocated from arena
+	Arena* arena;		//Memory for the match lists, or NULL
+	int* accelOf;		//Index in accel of how to skip ahead in each state, or -1; NULL if not accelerated
+	Accel* accel;
+	void* mapping;		//File mapped by DFA_map that accept, tTable and the match lists point into, or NULL
+	size_t mappedSize;
 }DFA;
 
+// Default for DFA_accelerate: states left by at most this many symbols are accelerated
+#define DFA_ACCEL_ESCAPES 16
+
+/**
+* Match state for running a DFA over an input that arrives in pieces.
+* The DFA itself is never modified, so any number of contexts may share it.
+*/
+typedef struct {
+	const DFA* dfa;
+	int state;			//Current state, or -1 once no transition was available
+}DFA_Context;
+
 /**
 * Allocate and return a new DFA containing the given number of states.
 */
 extern DFA* DFA_new(int nstates);
 
+/**
+* Allocate and return a new DFA containing the given number of states, whose
+* input symbols are grouped into nclasses classes by the classes map.
+* Transitions are then the same for every symbol of a class.
+*/
+extern DFA* DFA_new_classes(int nstates, const uint8_t* classes, int nclasses);
+
 /**
 * Free the given DFA.
 */
@@ -42,13 +74,13 @@ extern void DFA_free(DFA* dfa);
 /**
 * Return the number of states in the given DFA.
 */
-extern int DFA_get_size(DFA* dfa);
+extern int DFA_get_size(const DFA* dfa);
 
 /**
 * Return the state specified by the given DFA's transition function from
 * state src on input symbol sym.
 */
-extern int DFA_get_transition(DFA* dfa, int src, char sym);
+extern int DFA_get_transition(const DFA* dfa, int src, char sym);
 
 /**
 * For the given DFA, set the transition from state src on input symbol
@@ -56,6 +88,18 @@ extern int DFA_get_transition(DFA* dfa, int src, char sym);
 */
 extern void DFA_set_transition(DFA* dfa, int src, char sym, int dst);
 
+/**
+* Return the state the given DFA goes to from state src on any symbol of
+* class cls.
+*/
+extern int DFA_get_class_transition(const DFA* dfa, int src, int cls);
+
+/**
+* Set the transition of the given DFA from state src on every symbol of
+* class cls to be the state dst.
+*/
+extern void DFA_set_class_transition(DFA* dfa, int src, int cls, int dst);
+
 /**
 * Set the transitions of the given DFA for each symbol in the given str.
 * This is a nice shortcut when you have multiple labels on an edge between
@@ -77,17 +121,89 @@ extern void DFA_set_accepting(DFA* dfa, int state, bool value);
 /**
 * Return true if the given DFA's state is an accepting state.
 */
-extern bool DFA_get_accepting(DFA* dfa, int state);
+extern bool DFA_get_accepting(const DFA* dfa, int state);
+
+/**
+* Make the given DFA's state report the n pattern ids in ids, which must be
+* sorted and distinct, when the input ends there. The state is accepting
+* if n is greater than 0. Accepting states whose patterns are never set
+* report pattern 0.
+*/
+extern void DFA_set_matches(DFA* dfa, int state, const int* ids, int n);
+
+/**
+* Return the number of patterns the given DFA's state reports, storing a
+* pointer to their sorted ids in *ids.
+*/
+extern int DFA_get_matches(const DFA* dfa, int state, const int** ids);
+
+/**
+* Compress the given DFA's table by merging input symbols whose columns are
+* identical into one class, and return the number of classes. Setting a
+* transition afterwards gives its symbol a column of its own if it needs one.
+*/
+extern int DFA_compress(DFA* dfa);
+
+/**
+* Find the states of the given DFA that are left by at most maxEscapes
+* symbols, looping back to themselves on all the others, and record
+* those escape symbols. DFA_execute and DFA_feed then skip runs of input
+* that stay in such a state with a vectorized byte search, rather than
+* taking the self-loop once per byte. Returns the number of states
+* accelerated. Setting a transition afterwards, or passing a negative
+* maxEscapes, removes the acceleration.
+*/
+extern int DFA_accelerate(DFA* dfa, int maxEscapes);
 
 /**
 * Run the given DFA on the given input string, and return true if it accepts
-* the input, otherwise false.
+* the input, otherwise false. The DFA is not modified, so one DFA may be run
+* on many threads at once.
+*/
+extern bool DFA_execute(const DFA* dfa, const char *input);
+
+/**
+* Run the given DFA over len bytes of input and call report(arg, pattern,
+* end) for every pattern reported by every accepting state it passes
+* through, where end is the number of bytes read so far (from 0 to len).
+* So for a DFA whose patterns all begin with .*, every end offset of every
+* pattern is found in one pass. Returns the number of reports made.
+*/
+extern size_t DFA_match_all(const DFA* dfa, const uint8_t* input, size_t len,
+	void(*report)(void* arg, int pattern, size_t end), void* arg);
+
+/**
+* Allocate and return a new match context for the given DFA, positioned at
+* the start of an input.
+*/
+extern DFA_Context* DFA_context_new(const DFA* dfa);
+
+/**
+* Free the given match context (but not its DFA).
+*/
+extern void DFA_context_free(DFA_Context* ctx);
+
+/**
+* Return the given match context to the start of a new input.
+*/
+extern void DFA_context_reset(DFA_Context* ctx);
+
+/**
+* Advance the given match context over the next len bytes of its input.
+* Returns false once the input can no longer be accepted, after which
+* further calls do nothing.
+*/
+extern bool DFA_feed(DFA_Context* ctx, const uint8_t* buf, size_t len);
+
+/**
+* Return true if the input fed to the given match context so far is
+* accepted by its DFA. The context is unchanged, so more input may follow.
 */
-extern bool DFA_execute(DFA* dfa, char *input);
+extern bool DFA_finish(DFA_Context* ctx);
 
 /**
 * Print the given DFA to System.out.
 */
-extern void DFA_print(DFA* dfa);
+extern void DFA_print(const DFA* dfa);
 
 #endif
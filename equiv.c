@@ -0,0 +1,415 @@
+/*
+* Author: Peter Hess
+* File: equiv.c
+*
+* Implements the equivalence and inclusion checks. Each is a breadth-first
+* search over pairs of states of the two automata, from the pair of start
+* states, that stops at the first pair where one accepts and the other does
+* not; as the search is breadth-first, the path to that pair spells out a
+* shortest counterexample. The searches differ in which pairs they skip:
+* DFA_equivalent skips pairs already known to be equivalent by union-find,
+* the inclusion checks skip pairs seen before (found by a PairMap), and
+* DFA_included_NFA skips pairs subsumed by an antichain.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "dfa.h"
+#include "nfa.h"
+#include "IntSet.h"
+#include "Arena.h"
+#include "PairMap.h"
+#include "subset.h"
+#include "equiv.h"
+
+#define HALT -1
+
+//Breadth-first queue of pairs, with how each was reached, for rebuilding counterexamples
+typedef struct {
+	int size;
+	int capacity;
+	int* a;
+	int* b;
+	int* parent;		//Index of the pair this one was reached from, or -1 for a start pair
+	int* depth;			//Length of the path to the pair
+	uint8_t* sym;		//Symbol the pair was reached on
+}EquivQueue;
+
+static void EquivQueue_init(EquivQueue* queue) {
+	(queue->size) = 0;
+	(queue->capacity) = 64;
+	(queue->a) = (int*)malloc((queue->capacity) * sizeof(int));
+	(queue->b) = (int*)malloc((queue->capacity) * sizeof(int));
+	(queue->parent) = (int*)malloc((queue->capacity) * sizeof(int));
+	(queue->depth) = (int*)malloc((queue->capacity) * sizeof(int));
+	(queue->sym) = (uint8_t*)malloc((queue->capacity) * sizeof(uint8_t));
+}
+
+static void EquivQueue_free(EquivQueue* queue) {
+	free(queue->a);
+	free(queue->b);
+	free(queue->parent);
+	free(queue->depth);
+	free(queue->sym);
+}
+
+//Append the pair (a, b), reached from pair parent on sym, and return its index
+static int EquivQueue_push(EquivQueue* queue, int a, int b, int parent, int sym) {
+	if ((queue->size) == (queue->capacity)) {
+		(queue->capacity) *= 2;
+		(queue->a) = (int*)realloc(queue->a, (queue->capacity) * sizeof(int));
+		(queue->b) = (int*)realloc(queue->b, (queue->capacity) * sizeof(int));
+		(queue->parent) = (int*)realloc(queue->parent, (queue->capacity) * sizeof(int));
+		(queue->depth) = (int*)realloc(queue->depth, (queue->capacity) * sizeof(int));
+		(queue->sym) = (uint8_t*)realloc(queue->sym, (queue->capacity) * sizeof(uint8_t));
+	}
+	int n = (queue->size)++;
+	(queue->a)[n] = a;
+	(queue->b)[n] = b;
+	(queue->parent)[n] = parent;
+	(queue->depth)[n] = (parent == -1) ? 0 : (queue->depth)[parent] + 1;
+	(queue->sym)[n] = (uint8_t)sym;
+	return n;
+}
+
+//New string of the symbols on the path to pair i
+static char* equivWitness(const EquivQueue* queue, int i) {
+	int len = (queue->depth)[i];
+	char* witness = (char*)malloc(len + 1);
+	witness[len] = '\0';
+	for (int j = i; (queue->parent)[j] != -1; j = (queue->parent)[j]) {
+		witness[--len] = (char)(queue->sym)[j];
+	}
+	return witness;
+}
+
+//Store the counterexample for pair i if asked for; return false for the caller to return
+static bool equivFail(const EquivQueue* queue, int i, char** counterexample) {
+	if (counterexample != NULL) {
+		*counterexample = equivWitness(queue, i);
+	}
+	return false;
+}
+
+/*
+* Store in symOf one symbol of each class of symbols that both maps of
+* symbols to classes treat alike, and return the number of such classes.
+* The symbol chosen is not 0 unless the class holds only 0.
+*/
+static int equivClasses(const uint8_t* classesA, int ka, const uint8_t* classesB, int kb, int* symOf) {
+	int* classOf = (int*)malloc((size_t)ka * kb * sizeof(int));
+	for (int i = 0; i < ka * kb; i++) {
+		classOf[i] = -1;
+	}
+	int n = 0;
+	for (int i = 1; i <= sigma; i++) {
+		int sym = i % sigma;								//Symbol 0 last
+		int* c = &(classOf[classesA[sym] * kb + classesB[sym]]);
+		if (*c == -1) {
+			*c = n;
+			symOf[n++] = sym;
+		}
+	}
+	free(classOf);
+	return n;
+}
+
+//Representative of x's set, halving the path on the way
+static int equivFind(int* parent, int x) {
+	while (parent[x] != x) {
+		parent[x] = parent[parent[x]];
+		x = parent[x];
+	}
+	return x;
+}
+
+/**
+* Return true if the given DFAs accept the same strings. Otherwise, if
+* counterexample is not NULL, store in it a shortest string accepted by one
+* DFA but not the other.
+*/
+bool DFA_equivalent(const DFA* a, const DFA* b, char** counterexample) {
+	int na = (a->numStates);
+	int nb = (b->numStates);
+	int dead = na + nb;										//HALT in either DFA; states of b follow those of a
+	int symOf[sigma];
+	int nclasses = equivClasses(a->classes, a->numClasses, b->classes, b->numClasses, symOf);
+	int* parent = (int*)malloc((dead + 1) * sizeof(int));	//Union-find forest over the states of both DFAs
+	int* rank = (int*)calloc(dead + 1, sizeof(int));
+	for (int x = 0; x <= dead; x++) {
+		parent[x] = x;
+	}
+
+	EquivQueue queue;
+	EquivQueue_init(&queue);
+	int startA = (na > 0) ? 0 : dead;
+	int startB = (nb > 0) ? na : dead;
+	parent[startB] = startA;
+	EquivQueue_push(&queue, startA, startB, -1, 0);
+	int failed = -1;
+	for (int head = 0; head < (queue.size) && failed == -1; head++) {
+		int x = (queue.a)[head];
+		int y = (queue.b)[head];
+		bool acceptX = (x < na) && DFA_get_accepting(a, x);
+		bool acceptY = (y != dead) && DFA_get_accepting(b, y - na);
+		if (acceptX != acceptY) {
+			failed = head;
+			break;
+		}
+		for (int c = 0; c < nclasses; c++) {
+			int sym = symOf[c];
+			int nx = (x < na) ? DFA_get_class_transition(a, x, (a->classes)[sym]) : HALT;
+			int ny = (y != dead) ? DFA_get_class_transition(b, y - na, (b->classes)[sym]) : HALT;
+			nx = (nx == HALT) ? dead : nx;
+			ny = (ny == HALT) ? dead : na + ny;
+			int rx = equivFind(parent, nx);
+			int ry = equivFind(parent, ny);
+			if (rx != ry) {									//Not yet known to be equivalent: join and check later
+				if (rank[rx] < rank[ry]) {
+					parent[rx] = ry;
+				}
+				else {
+					parent[ry] = rx;
+					rank[rx] += (rank[rx] == rank[ry]);
+				}
+				EquivQueue_push(&queue, nx, ny, head, sym);
+			}
+		}
+	}
+	bool equal = (failed == -1) || equivFail(&queue, failed, counterexample);
+	EquivQueue_free(&queue);
+	free(parent);
+	free(rank);
+	return equal;
+}
+
+/**
+* Return true if every string accepted by DFA a is accepted by DFA b.
+* Otherwise, if counterexample is not NULL, store in it a shortest string
+* accepted by a but not by b.
+*/
+bool DFA_included(const DFA* a, const DFA* b, char** counterexample) {
+	if ((a->numStates) == 0) {
+		return true;
+	}
+	int symOf[sigma];
+	int nclasses = equivClasses(a->classes, a->numClasses, b->classes, b->numClasses, symOf);
+	PairMap* seen = PairMap_new();
+	EquivQueue queue;
+	EquivQueue_init(&queue);
+	int startB = ((b->numStates) > 0) ? 0 : HALT;
+	PairMap_put(seen, 0, startB, EquivQueue_push(&queue, 0, startB, -1, 0));
+	int failed = -1;
+	for (int head = 0; head < (queue.size); head++) {
+		int p = (queue.a)[head];
+		int q = (queue.b)[head];
+		if (DFA_get_accepting(a, p) && (q == HALT || !DFA_get_accepting(b, q))) {
+			failed = head;
+			break;
+		}
+		for (int c = 0; c < nclasses; c++) {
+			int sym = symOf[c];
+			int np = DFA_get_class_transition(a, p, (a->classes)[sym]);
+			int nq = (q == HALT) ? HALT : DFA_get_class_transition(b, q, (b->classes)[sym]);
+			if (np != HALT && PairMap_get(seen, np, nq) == -1) {	//Nothing is accepted once a halts
+				PairMap_put(seen, np, nq, EquivQueue_push(&queue, np, nq, head, sym));
+			}
+		}
+	}
+	bool included = (failed == -1) || equivFail(&queue, failed, counterexample);
+	EquivQueue_free(&queue);
+	PairMap_free(seen);
+	return included;
+}
+
+/**
+* Return true if every string accepted by the given NFA is accepted by the
+* given DFA. Otherwise, if counterexample is not NULL, store in it a
+* shortest string accepted by the NFA but not by the DFA.
+*/
+bool NFA_included(const NFA* nfa, const DFA* dfa, char** counterexample) {
+	if ((nfa->numStates) == 0) {
+		return true;
+	}
+	int runEnd[sigma];										//Last symbol of the run of each symbol's DFA class
+	for (int sym = sigma - 1; sym >= 0; sym--) {
+		runEnd[sym] = (sym + 1 < sigma && (dfa->classes)[sym + 1] == (dfa->classes)[sym]) ? runEnd[sym + 1] : sym;
+	}
+	IntSet* reached = IntSet_new(nfa->numStates);
+	PairMap* seen = PairMap_new();
+	EquivQueue queue;
+	EquivQueue_init(&queue);
+	int startB = ((dfa->numStates) > 0) ? 0 : HALT;
+	IntSet_add(reached, 0);
+	NFA_close_set(nfa, reached);
+	IntSetIterator iter;
+	IntSetIterator_init(&iter, reached);
+	while (IntSetIterator_has_next(&iter)) {				//One start pair for each state of the NFA's start closure
+		int s = IntSetIterator_next(&iter);
+		PairMap_put(seen, s, startB, EquivQueue_push(&queue, s, startB, -1, 0));
+	}
+	int failed = -1;
+	for (int head = 0; head < (queue.size) && failed == -1; head++) {
+		int s = (queue.a)[head];
+		int q = (queue.b)[head];
+		if (NFA_get_accepting(nfa, s) && (q == HALT || !DFA_get_accepting(dfa, q))) {
+			failed = head;
+			break;
+		}
+		const NFA_Edge* edges;
+		int nedges = NFA_get_edges(nfa, s, &edges);
+		for (int i = 0; i < nedges; i++) {
+			for (int lo = edges[i].lo; lo <= edges[i].hi; lo = runEnd[lo] + 1) {	//Once per run of a DFA class
+				int sym = (lo == 0 && edges[i].hi >= 1 && runEnd[0] >= 1) ? 1 : lo;	//Not 0 if the edge has another symbol of its class
+				int nq = (q == HALT) ? HALT : DFA_get_class_transition(dfa, q, (dfa->classes)[sym]);
+				IntSet_clear(reached);
+				IntSet_add(reached, edges[i].dst);
+				NFA_close_set(nfa, reached);
+				IntSetIterator_init(&iter, reached);
+				while (IntSetIterator_has_next(&iter)) {
+					int t = IntSetIterator_next(&iter);
+					if (PairMap_get(seen, t, nq) == -1) {
+						PairMap_put(seen, t, nq, EquivQueue_push(&queue, t, nq, head, sym));
+					}
+				}
+			}
+		}
+	}
+	bool included = (failed == -1) || equivFail(&queue, failed, counterexample);
+	EquivQueue_free(&queue);
+	PairMap_free(seen);
+	IntSet_free(reached);
+	return included;
+}
+
+//Queue indices of the pairs of one DFA state whose sets of NFA states are minimal
+typedef struct {
+	int size;
+	int capacity;
+	int* items;
+}Antichain;
+
+//Pairs of a DFA state and a set of NFA states, for DFA_included_NFA
+typedef struct {
+	EquivQueue queue;	//The DFA state of each pair is in a; b is unused
+	IntSet** sets;		//Set of NFA states of each pair
+	bool* superseded;	//Pair made redundant by a subset of its set found at the same depth
+	int capacity;		//Room in sets and superseded
+	Antichain* chains;	//Antichain of each DFA state
+}SubsetQueue;
+
+//Queue the pair (q, set), reached from pair parent on sym, unless q was paired with a subset of set before; return true if queued
+static bool SubsetQueue_offer(SubsetQueue* sq, int q, IntSet* set, int parent, int sym) {
+	Antichain* chain = &((sq->chains)[q]);
+	for (int i = 0; i < (chain->size); i++) {
+		if (IntSet_is_subset((sq->sets)[(chain->items)[i]], set)) {
+			return false;
+		}
+	}
+	int n = EquivQueue_push(&(sq->queue), q, 0, parent, sym);
+	if (n == (sq->capacity)) {
+		(sq->capacity) = (sq->queue).capacity;
+		(sq->sets) = (IntSet**)realloc(sq->sets, (sq->capacity) * sizeof(IntSet*));
+		(sq->superseded) = (bool*)realloc(sq->superseded, (sq->capacity) * sizeof(bool));
+	}
+	(sq->sets)[n] = set;
+	(sq->superseded)[n] = false;
+	int kept = 0;
+	for (int i = 0; i < (chain->size); i++) {				//Drop the sets that set is a subset of
+		int j = (chain->items)[i];
+		if (IntSet_is_subset(set, (sq->sets)[j])) {
+			(sq->superseded)[j] = ((sq->queue).depth[j] == (sq->queue).depth[n]);	//A pair further from the start may not stand in for it
+		}
+		else {
+			(chain->items)[kept++] = j;
+		}
+	}
+	(chain->size) = kept;
+	if ((chain->size) == (chain->capacity)) {
+		(chain->capacity) = ((chain->capacity) == 0) ? 4 : 2 * (chain->capacity);
+		(chain->items) = (int*)realloc(chain->items, (chain->capacity) * sizeof(int));
+	}
+	(chain->items)[(chain->size)++] = n;
+	return true;
+}
+
+/**
+* Return true if every string accepted by the given DFA is accepted by the
+* given NFA. Otherwise, if counterexample is not NULL, store in it a
+* shortest string accepted by the DFA but not by the NFA.
+*/
+bool DFA_included_NFA(const DFA* dfa, const NFA* nfa, char** counterexample) {
+	if ((dfa->numStates) == 0) {
+		return true;
+	}
+	uint8_t nfaClasses[sigma];
+	int knfa = NFA_get_classes(nfa, nfaClasses);
+	int symOf[sigma];
+	int nclasses = equivClasses(dfa->classes, dfa->numClasses, nfaClasses, knfa, symOf);
+	Arena* arena = Arena_new(0);							//Holds every set of NFA states
+	SubsetQueue sq;
+	EquivQueue_init(&(sq.queue));
+	(sq.sets) = NULL;
+	(sq.superseded) = NULL;
+	(sq.capacity) = 0;
+	(sq.chains) = (Antichain*)calloc(dfa->numStates, sizeof(Antichain));
+
+	IntSet* next = IntSet_new_in(arena, nfa->numStates);
+	IntSet_add(next, 0);
+	NFA_close_set(nfa, next);
+	SubsetQueue_offer(&sq, 0, next, -1, 0);
+	next = IntSet_new_in(arena, nfa->numStates);
+	int failed = -1;
+	for (int head = 0; head < (sq.queue.size); head++) {
+		if ((sq.superseded)[head]) {
+			continue;
+		}
+		int p = (sq.queue.a)[head];
+		const IntSet* set = (sq.sets)[head];
+		if (DFA_get_accepting(dfa, p) && !subsetAccepting(nfa, set)) {
+			failed = head;
+			break;
+		}
+		for (int c = 0; c < nclasses; c++) {
+			int np = DFA_get_class_transition(dfa, p, (dfa->classes)[symOf[c]]);
+			if (np == HALT) {								//Nothing is accepted once the DFA halts
+				continue;
+			}
+			subsetSuccessor(nfa, set, symOf[c], next);
+			if (SubsetQueue_offer(&sq, np, next, head, symOf[c])) {
+				next = IntSet_new_in(arena, nfa->numStates);
+			}
+		}
+	}
+	bool included = (failed == -1) || equivFail(&(sq.queue), failed, counterexample);
+	for (int q = 0; q < (dfa->numStates); q++) {
+		free((sq.chains)[q].items);
+	}
+	free(sq.chains);
+	free(sq.sets);
+	free(sq.superseded);
+	EquivQueue_free(&(sq.queue));
+	Arena_free(arena);
+	return included;
+}
+
+/**
+* Return true if the given NFA and the given DFA accept the same strings.
+* Otherwise, if counterexample is not NULL, store in it the shorter of the
+* counterexamples of NFA_included and DFA_included_NFA.
+*/
+bool NFA_equivalent(const NFA* nfa, const DFA* dfa, char** counterexample) {
+	char* over = NULL;
+	char* under = NULL;
+	bool equal = NFA_included(nfa, dfa, (counterexample != NULL) ? &over : NULL);
+	equal = DFA_included_NFA(dfa, nfa, (counterexample != NULL) ? &under : NULL) && equal;
+	if (!equal && counterexample != NULL) {
+		bool shorter = (over != NULL) && (under == NULL || strlen(over) <= strlen(under));
+		*counterexample = shorter ? over : under;
+		free(shorter ? under : over);
+	}
+	return equal;
+}
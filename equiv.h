@@ -0,0 +1,64 @@
+/*
+* Author: Peter Hess
+* File: equiv.h
+*
+* Checking that automata accept the same strings, or that one accepts only
+* strings another accepts, with a shortest string that shows otherwise.
+*/
+
+#ifndef _equiv_h
+#define _equiv_h
+
+#include <stdbool.h>
+#include "dfa.h"
+#include "nfa.h"
+
+/**
+* Return true if the given DFAs accept the same strings. Otherwise, if
+* counterexample is not NULL, store in it a new string, to be freed by the
+* caller, of the shortest length accepted by one DFA but not the other.
+* Uses Hopcroft and Karp's union-find check: pairs of states are visited
+* breadth-first from the pair of start states, and a pair whose states are
+* already known to be equivalent is skipped, so at most one pair is visited
+* per state of either DFA, and the product of the DFAs is never built.
+* Counterexamples use symbol 0 only where no other symbol will do.
+*/
+extern bool DFA_equivalent(const DFA* a, const DFA* b, char** counterexample);
+
+/**
+* Return true if every string accepted by DFA a is accepted by DFA b.
+* Otherwise, if counterexample is not NULL, store in it a new string, to be
+* freed by the caller, of the shortest length accepted by a but not by b.
+* Only the pairs of states reachable from the pair of start states are
+* visited, and pairs where a has halted are not followed.
+*/
+extern bool DFA_included(const DFA* a, const DFA* b, char** counterexample);
+
+/**
+* Return true if every string accepted by the given NFA, which must be
+* closed if it has epsilon moves, is accepted by the given DFA. Otherwise,
+* store a shortest counterexample as for DFA_included. The NFA is not
+* determinized: the pairs of one NFA state and one DFA state reachable
+* from the start are visited breadth-first.
+*/
+extern bool NFA_included(const NFA* nfa, const DFA* dfa, char** counterexample);
+
+/**
+* Return true if every string accepted by the given DFA is accepted by the
+* given NFA, which must be closed if it has epsilon moves. Otherwise, store
+* a shortest counterexample as for DFA_included. The NFA is determinized on
+* the fly, pruned by antichains: a pair of a DFA state and a set of NFA
+* states is not followed if the same DFA state was already paired with a
+* subset of that set, since any string the larger set rejects the smaller
+* one rejects too.
+*/
+extern bool DFA_included_NFA(const DFA* dfa, const NFA* nfa, char** counterexample);
+
+/**
+* Return true if the given NFA, which must be closed if it has epsilon
+* moves, and the given DFA accept the same strings. Otherwise, store the
+* shorter of the counterexamples of NFA_included and DFA_included_NFA.
+*/
+extern bool NFA_equivalent(const NFA* nfa, const DFA* dfa, char** counterexample);
+
+#endif
@@ -0,0 +1,355 @@
+/*
+* Author: Peter Hess
+* File: minimize.c
+*
+* Hopcroft DFA minimization, in the formulation of Valmari and Lehtinen
+* ("Efficient minimization of DFAs with partial transition functions"):
+* states and transitions are both kept in refinable partitions, and each
+* new block of transitions splits the blocks of states that lead into it.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "dfa.h"
+#include "minimize.h"
+#include "Arena.h"
+
+#define HALT -1
+
+/*
+* Refinable partition of the elements 0..n-1. Elements are kept in E so
+* that each set is a contiguous range F[s]..P[s]-1; L is the inverse of E
+* and S gives each element's set. Marked elements of a set are moved to
+* the front of its range.
+*/
+typedef struct {
+	int z;				//Number of sets
+	int* E;
+	int* L;
+	int* S;
+	int* F;
+	int* P;
+}Partition;
+
+//Marking state shared by both partitions, as only one is split at a time
+typedef struct {
+	int* M;				//Number of marked elements in each set
+	int* W;				//Sets with marked elements
+	int w;
+}Marks;
+
+static void Partition_init(Partition* p, int n, Arena* arena) {
+	(p->z) = (n > 0);
+	(p->E) = (int*)Arena_alloc(arena, (n + 1) * sizeof(int));
+	(p->L) = (int*)Arena_alloc(arena, (n + 1) * sizeof(int));
+	(p->S) = (int*)Arena_alloc(arena, (n + 1) * sizeof(int));
+	(p->F) = (int*)Arena_alloc(arena, (n + 1) * sizeof(int));
+	(p->P) = (int*)Arena_alloc(arena, (n + 1) * sizeof(int));
+	for (int i = 0; i < n; i++) {
+		(p->E)[i] = (p->L)[i] = i;
+		(p->S)[i] = 0;
+	}
+	if (p->z) {
+		(p->F)[0] = 0;
+		(p->P)[0] = n;
+	}
+}
+
+static void Partition_mark(Partition* p, Marks* m, int e) {
+	int s = (p->S)[e];
+	int i = (p->L)[e];
+	int j = (p->F)[s] + (m->M)[s];
+	(p->E)[i] = (p->E)[j];
+	(p->L)[(p->E)[i]] = i;
+	(p->E)[j] = e;
+	(p->L)[e] = j;
+	if ((m->M)[s]++ == 0) {
+		(m->W)[(m->w)++] = s;
+	}
+}
+
+//Split every set with marked elements into its marked and unmarked parts; the smaller part gets a new set number
+static void Partition_split(Partition* p, Marks* m) {
+	while (m->w) {
+		int s = (m->W)[--(m->w)];
+		int j = (p->F)[s] + (m->M)[s];
+		if (j == (p->P)[s]) {		//Every element was marked
+			(m->M)[s] = 0;
+			continue;
+		}
+		int z = (p->z);
+		if ((m->M)[s] <= (p->P)[s] - j) {
+			(p->F)[z] = (p->F)[s];
+			(p->P)[z] = (p->F)[s] = j;
+		}
+		else {
+			(p->P)[z] = (p->P)[s];
+			(p->F)[z] = (p->P)[s] = j;
+		}
+		for (int i = (p->F)[z]; i < (p->P)[z]; i++) {
+			(p->S)[(p->E)[i]] = z;
+		}
+		(m->M)[s] = (m->M)[z] = 0;
+		(p->z) += 1;
+	}
+}
+
+//A state and the patterns it reports, for grouping states that report the same ones
+typedef struct {
+	int state;
+	int n;
+	const int* ids;
+}Report;
+
+//Order Reports by their patterns, non-accepting states (no patterns) first
+static int compareReports(const void* a, const void* b) {
+	const Report* x = (const Report*)a;
+	const Report* y = (const Report*)b;
+	if ((x->n) != (y->n)) {
+		return (x->n) < (y->n) ? -1 : 1;
+	}
+	for (int i = 0; i < (x->n); i++) {
+		if ((x->ids)[i] != (y->ids)[i]) {
+			return (x->ids)[i] < (y->ids)[i] ? -1 : 1;
+		}
+	}
+	return 0;
+}
+
+//Mark in keep every state reachable from start along edges (src -> dst), given as CSR adjacency
+static void reach(int start, const int* adjStart, const int* adj, bool* keep, int* stack) {
+	int top = 0;
+	keep[start] = true;
+	stack[top++] = start;
+	while (top > 0) {
+		int q = stack[--top];
+		for (int i = adjStart[q]; i < adjStart[q + 1]; i++) {
+			if (!keep[adj[i]]) {
+				keep[adj[i]] = true;
+				stack[top++] = adj[i];
+			}
+		}
+	}
+}
+
+//Build CSR adjacency from the edges (from[i] -> to[i]), grouped by from
+static void adjacency(int n, int m, int* from, int* to, int* adjStart, int* adj, int* edgeOf, Arena* arena) {
+	for (int q = 0; q <= n; q++) {
+		adjStart[q] = 0;
+	}
+	for (int i = 0; i < m; i++) {
+		adjStart[from[i] + 1]++;
+	}
+	for (int q = 0; q < n; q++) {
+		adjStart[q + 1] += adjStart[q];
+	}
+	int* pos = (int*)Arena_alloc(arena, (n + 1) * sizeof(int));
+	memcpy(pos, adjStart, (n + 1) * sizeof(int));
+	for (int i = 0; i < m; i++) {
+		int k = pos[from[i]]++;
+		if (adj != NULL) {
+			adj[k] = to[i];
+		}
+		if (edgeOf != NULL) {
+			edgeOf[k] = i;
+		}
+	}
+}
+
+/**
+* Return a new DFA with the fewest possible states that accepts the same
+* language as the given DFA, which is not changed.
+*/
+DFA* DFA_minimize(const DFA* dfa) {
+	int n = (dfa->numStates);
+	int k = (dfa->numClasses);
+	if (n == 0) {									//No start state: nothing to partition, and nothing is accepted
+		return DFA_new(0);
+	}
+	Arena* arena = Arena_new(0);					//Holds every array used by this run
+
+	//Collect the transitions as edges tail -label-> head
+	int m = 0;
+	int* T = (int*)Arena_alloc(arena, ((size_t)n * k + 1) * sizeof(int));
+	int* Lb = (int*)Arena_alloc(arena, ((size_t)n * k + 1) * sizeof(int));
+	int* H = (int*)Arena_alloc(arena, ((size_t)n * k + 1) * sizeof(int));
+	for (int q = 0; q < n; q++) {
+		for (int c = 0; c < k; c++) {
+			int dst = DFA_get_class_transition(dfa, q, c);
+			if (dst != HALT) {
+				T[m] = q;
+				Lb[m] = c;
+				H[m] = dst;
+				m++;
+			}
+		}
+	}
+
+	//Keep only states reachable from 0 that can also reach an accepting state
+	int* adjStart = (int*)Arena_alloc(arena, (n + 1) * sizeof(int));
+	int* adj = (int*)Arena_alloc(arena, (m + 1) * sizeof(int));
+	int* stack = (int*)Arena_alloc(arena, (n + 1) * sizeof(int));
+	bool* reachable = (bool*)Arena_calloc(arena, n, sizeof(bool));
+	bool* live = (bool*)Arena_calloc(arena, n, sizeof(bool));
+	adjacency(n, m, T, H, adjStart, adj, NULL, arena);
+	reach(0, adjStart, adj, reachable, stack);
+	adjacency(n, m, H, T, adjStart, adj, NULL, arena);		//Reversed edges
+	for (int q = 0; q < n; q++) {
+		if ((dfa->accept)[q] && reachable[q] && !live[q]) {
+			reach(q, adjStart, adj, live, stack);
+		}
+	}
+
+	int* id = (int*)Arena_alloc(arena, n * sizeof(int));		//Index of each kept state, or -1
+	int nn = 0;
+	for (int q = 0; q < n; q++) {
+		id[q] = (q == 0 || (reachable[q] && live[q])) ? nn++ : -1;
+	}
+	int mm = 0;
+	for (int i = 0; i < m; i++) {
+		if (id[T[i]] >= 0 && id[H[i]] >= 0) {
+			T[mm] = id[T[i]];
+			Lb[mm] = Lb[i];
+			H[mm] = id[H[i]];
+			mm++;
+		}
+	}
+
+	Marks marks;
+	int big = (nn > mm ? nn : mm) + 1;
+	marks.M = (int*)Arena_calloc(arena, big, sizeof(int));
+	marks.W = (int*)Arena_alloc(arena, big * sizeof(int));
+	marks.w = 0;
+
+	//Initial partition of states: accepting and non-accepting, or one block per set of patterns reported
+	Partition B;
+	Partition_init(&B, nn, arena);
+	if ((dfa->matches) == NULL) {
+		for (int q = 0; q < n; q++) {
+			if (id[q] >= 0 && (dfa->accept)[q]) {
+				Partition_mark(&B, &marks, id[q]);
+			}
+		}
+		Partition_split(&B, &marks);
+	}
+	else {
+		Report* reports = (Report*)Arena_alloc(arena, (nn + 1) * sizeof(Report));
+		for (int q = 0; q < n; q++) {
+			if (id[q] >= 0) {
+				reports[id[q]].state = id[q];
+				reports[id[q]].n = DFA_get_matches(dfa, q, &(reports[id[q]].ids));
+			}
+		}
+		qsort(reports, nn, sizeof(Report), compareReports);
+		bool firstRun = true;
+		for (int i = 1; i < nn; i++) {			//Split off each run of equal reports after the first
+			if (compareReports(&(reports[i - 1]), &(reports[i])) != 0) {
+				Partition_split(&B, &marks);
+				firstRun = false;
+			}
+			if (!firstRun) {
+				Partition_mark(&B, &marks, reports[i].state);
+			}
+		}
+		Partition_split(&B, &marks);
+	}
+
+	//Initial partition of transitions: one set per label
+	Partition C;
+	Partition_init(&C, mm, arena);
+	if (mm > 0) {
+		int* labelStart = (int*)Arena_alloc(arena, (k + 1) * sizeof(int));
+		adjacency(k, mm, Lb, NULL, labelStart, NULL, C.E, arena);		//C.E lists the edges sorted by label
+		C.z = 0;
+		int label = Lb[C.E[0]];
+		C.F[0] = 0;
+		for (int i = 0; i < mm; i++) {
+			int t = C.E[i];
+			if (Lb[t] != label) {
+				label = Lb[t];
+				C.P[C.z++] = i;
+				C.F[C.z] = i;
+			}
+			C.S[t] = C.z;
+			C.L[t] = i;
+		}
+		C.P[C.z++] = mm;
+	}
+
+	//Incoming edges of each state
+	int* inStart = (int*)Arena_alloc(arena, (nn + 1) * sizeof(int));
+	int* inEdge = (int*)Arena_alloc(arena, (mm + 1) * sizeof(int));
+	adjacency(nn, mm, H, NULL, inStart, NULL, inEdge, arena);
+
+	//Each set of transitions splits the blocks of their tails; each new block splits the transitions into it
+	int b = 1;
+	int c = 0;
+	while (c < C.z) {
+		for (int i = C.F[c]; i < C.P[c]; i++) {
+			Partition_mark(&B, &marks, T[C.E[i]]);
+		}
+		Partition_split(&B, &marks);
+		c++;
+		while (b < B.z) {
+			for (int i = B.F[b]; i < B.P[b]; i++) {
+				int q = B.E[i];
+				for (int j = inStart[q]; j < inStart[q + 1]; j++) {
+					Partition_mark(&C, &marks, inEdge[j]);
+				}
+			}
+			Partition_split(&C, &marks);
+			b++;
+		}
+	}
+
+	//Number the blocks breadth-first from the start state's block
+	int* blockId = (int*)Arena_alloc(arena, (B.z + 1) * sizeof(int));
+	int* order = (int*)Arena_alloc(arena, (B.z + 1) * sizeof(int));
+	for (int i = 0; i < B.z; i++) {
+		blockId[i] = -1;
+	}
+	int nblocks = 0;
+	blockId[B.S[0]] = nblocks;
+	order[nblocks++] = B.S[0];
+	int* outStart = adjStart;
+	int* outEdge = (int*)Arena_alloc(arena, (mm + 1) * sizeof(int));
+	adjacency(nn, mm, T, NULL, outStart, NULL, outEdge, arena);
+	for (int head = 0; head < nblocks; head++) {
+		int q = B.E[B.F[order[head]]];			//Any state of the block will do
+		for (int j = outStart[q]; j < outStart[q + 1]; j++) {
+			int blk = B.S[H[outEdge[j]]];
+			if (blockId[blk] == -1) {
+				blockId[blk] = nblocks;
+				order[nblocks++] = blk;
+			}
+		}
+	}
+
+	DFA* min = DFA_new_classes(nblocks, dfa->classes, k);
+	int* orig = (int*)Arena_alloc(arena, (nn + 1) * sizeof(int));		//Original state of each kept state
+	for (int q = 0; q < n; q++) {
+		if (id[q] >= 0) {
+			orig[id[q]] = q;
+		}
+	}
+	for (int i = 0; i < nblocks; i++) {
+		int q = B.E[B.F[order[i]]];
+		DFA_set_accepting(min, i, (dfa->accept)[orig[q]]);
+		if ((dfa->matches) != NULL) {
+			const int* ids;
+			int count = DFA_get_matches(dfa, orig[q], &ids);
+			DFA_set_matches(min, i, ids, count);
+		}
+		for (int j = outStart[q]; j < outStart[q + 1]; j++) {
+			int e = outEdge[j];
+			DFA_set_class_transition(min, i, Lb[e], blockId[B.S[H[e]]]);
+		}
+	}
+
+	Arena_free(arena);
+	DFA_compress(min);
+	DFA_accelerate(min, DFA_ACCEL_ESCAPES);
+	return min;
+}
@@ -0,0 +1,24 @@
+/*
+* Author: Peter Hess
+* File: minimize.h
+*
+* DFA minimization.
+*/
+
+#ifndef _minimize_h
+#define _minimize_h
+
+#include "dfa.h"
+
+/**
+* Return a new DFA with the fewest possible states that accepts the same
+* language as the given DFA, which is not changed. States that are
+* unreachable or can never lead to acceptance are dropped (transitions to
+* them become HALT), and the remaining states are merged by Hopcroft's
+* partition refinement in O(m log n) time for m transitions.
+* The start state of the result is 0; other states are numbered in
+* breadth-first order.
+*/
+extern DFA* DFA_minimize(const DFA* dfa);
+
+#endif
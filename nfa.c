@@ -10,35 +10,45 @@
 #include <stdlib.h>
 #include <stdio.h> 
 #include <stdbool.h>
+#include <string.h>
 #include "IntSet.h"
 #include "nfa.h"
+#include "ByteClass.h"
+#include "Arena.h"
+#include "BitNFA.h"
 
-#define sigma 128
-#define HALT IntSet_new()
+//Forget the bit-parallel form of the given NFA, which no longer matches it
+static void NFA_drop_bits(NFA* nfa) {
+	if ((nfa->bits) != NULL) {
+		BitNFA_free(nfa->bits);
+		(nfa->bits) = NULL;
+	}
+}
 
 /**
 * Allocate and return a new NFA containing the given number of states.
+* Sets of states are sized to nstates, which may be arbitrarily large.
 */
 NFA* NFA_new(int nstates) {
 	NFA* nfa = (NFA*)malloc(sizeof(NFA));
 	(nfa->numStates) = nstates;
 
-	(nfa->curr) = IntSet_new();										//Allocate a new IntSet for the current state, containing the state 0
-	IntSet_add(nfa->curr, 0);	
-
 	(nfa->accept) = (bool*)malloc(nstates * sizeof(bool));
-	(nfa->tTable) = (IntSet **)malloc(nstates * sizeof(IntSet*));
-
 	for (int i = 0; i < nstates; i++) {
-
-		(nfa->tTable)[i] = (IntSet*)malloc(sigma * sizeof(IntSet));	//Each row of tTable will be an array of 128 ints
 		(nfa->accept)[i] = false;									//Initially set all states to non-accepting
+	}
 
-		for (int j = 0; j < sigma; j++) {
-			(nfa->tTable)[i][j] = *HALT;							//Set all transitions to HALT (empty set), by default
-		}
+	(nfa->out) = (NFA_EdgeList*)calloc(nstates, sizeof(NFA_EdgeList));	//No transitions, so every state halts
+	(nfa->numEdges) = 0;
+	(nfa->numClasses) = 0;											//No dense rows until the NFA is packed
+	(nfa->arena) = Arena_new(0);
 
-	}
+	(nfa->epsilon) = NULL;											//Epsilon sets are only allocated once needed
+	(nfa->closure) = NULL;
+	(nfa->epsilonWords) = NULL;
+	(nfa->closed) = true;
+	(nfa->pattern) = NULL;											//Pattern ids are only allocated once set
+	(nfa->bits) = NULL;
 
 	return nfa;
 }
@@ -47,24 +57,100 @@ NFA* NFA_new(int nstates) {
 * Free the given NFA.
 */
 void NFA_free(NFA* nfa) {
-	free(nfa -> accept);
-	free(nfa->tTable);						
+	NFA_drop_bits(nfa);
+	Arena_free(nfa->arena);
+	free(nfa->out);
+	free(nfa->epsilon);
+	free(nfa->epsilonWords);
+	free(nfa->pattern);
+	free(nfa->accept);
 	free(nfa);
 }
 
 /**
 * Return the number of states in the given NFA.
 */
-int NFA_get_size(NFA* nfa) {
+int NFA_get_size(const NFA* nfa) {
 	return (nfa->numStates);
 }
 
 /**
-* Return the set of next states specified by the given NFA's transition
-* function from the given state on input symbol sym.
+* Add to the given set the next states specified by the given NFA's
+* transition function from the given state on input symbol sym.
+*/
+void NFA_get_transitions(const NFA* nfa, int state, char sym, IntSet* set) {
+	const NFA_EdgeList* list = &((nfa->out)[state]);
+	int c = (uint8_t)sym;
+	if ((list->row) != NULL) {
+		int nwords = (set->nwords);
+		const uint64_t* words = (list->row) + (size_t)(nfa->classes)[c] * nwords;
+		for (int w = 0; w < nwords; w++) {
+			(set->words)[w] |= words[w];
+		}
+		return;
+	}
+	for (int i = 0; i < (list->size) && (list->edges)[i].lo <= c; i++) {	//Sorted by lo, so stop at the first edge past c
+		if (c <= (list->edges)[i].hi) {
+			IntSet_add(set, (list->edges)[i].dst);
+		}
+	}
+}
+
+/**
+* Store in *edges the edges out of the given NFA's state, and return how
+* many there are.
+*/
+int NFA_get_edges(const NFA* nfa, int state, const NFA_Edge** edges) {
+	*edges = (nfa->out)[state].edges;
+	return (nfa->out)[state].size;
+}
+
+/**
+* For the given NFA, add the state dst to the set of next states from
+* state src on every input symbol from lo to hi. Edges to dst that overlap
+* or touch the range are merged into one, keeping the list canonical.
 */
-IntSet* NFA_get_transitions(NFA* nfa, int state, char sym) {
-	return &((nfa->tTable)[state][(int)sym]); //getting null ptrs
+void NFA_add_transition_range(NFA* nfa, int src, int lo, int hi, int dst) {
+	NFA_EdgeList* list = &((nfa->out)[src]);
+	NFA_Edge* edges = (list->edges);
+	for (int i = 0; i < (list->size); i++) {
+		if (edges[i].dst == dst && edges[i].lo <= lo && hi <= edges[i].hi) {
+			return;									//Already there
+		}
+	}
+	NFA_drop_bits(nfa);
+	int n = 0;
+	for (int i = 0; i < (list->size); i++) {		//Absorb the edges to dst that the new one meets
+		if (edges[i].dst == dst && edges[i].lo <= hi + 1 && lo <= edges[i].hi + 1) {
+			lo = (edges[i].lo < lo) ? edges[i].lo : lo;
+			hi = (edges[i].hi > hi) ? edges[i].hi : hi;
+		}
+		else {
+			edges[n++] = edges[i];
+		}
+	}
+	(nfa->numEdges) -= (list->size) - n;
+	(list->size) = n;
+
+	if ((list->size) == (list->capacity)) {		//Move to a list twice the size; the old one stays in the arena until packed
+		(list->capacity) = (list->capacity) > 0 ? 2 * (list->capacity) : 2;
+		NFA_Edge* grown = (NFA_Edge*)Arena_alloc(nfa->arena, (list->capacity) * sizeof(NFA_Edge));
+		if ((list->size) > 0) {
+			memcpy(grown, edges, (list->size) * sizeof(NFA_Edge));
+		}
+		(list->edges) = edges = grown;
+	}
+	int i = (list->size);
+	while (i > 0 && edges[i - 1].lo > lo) {		//Insert in order of lo
+		edges[i] = edges[i - 1];
+		i--;
+	}
+	edges[i].dst = dst;
+	edges[i].lo = (uint8_t)lo;
+	edges[i].hi = (uint8_t)hi;
+	(list->size)++;
+	(nfa->numEdges)++;
+	(list->row) = NULL;								//Stale until the next NFA_compress
 }
 
 /**
@@ -72,7 +158,7 @@ IntSet* NFA_get_transitions(NFA* nfa, int state, char sym) {
 * state src on input symbol sym.
 */
 void NFA_add_transition(NFA* nfa, int src, char sym, int dst) {
-	IntSet_add(&((nfa -> tTable)[src][(int)sym]), dst);
+	NFA_add_transition_range(nfa, src, (uint8_t)sym, (uint8_t)sym, dst);
 }
 
 /**
@@ -80,7 +166,7 @@ void NFA_add_transition(NFA* nfa, int src, char sym, int dst) {
 */
 void NFA_add_transition_str(NFA* nfa, int src, char *str, int dst) {
 	for (int i = 0; str[i] != '\0'; i++) {
-		IntSet_add(&((nfa->tTable)[src][(int)str[i]]), dst);
+		NFA_add_transition(nfa, src, str[i], dst);
 	}
 }
 
@@ -88,78 +174,544 @@ void NFA_add_transition_str(NFA* nfa, int src, char *str, int dst) {
 * Add a transition for the given NFA for each input symbol.
 */
 void NFA_add_transition_all(NFA* nfa, int src, int dst) {
-	for (int i = 0; i < sigma; i++) {
-		IntSet_add(&((nfa->tTable)[src][i]), dst);
+	NFA_add_transition_range(nfa, src, 0, sigma - 1, dst);	//One edge covers the whole alphabet
+}
+
+/**
+* For the given NFA, add an epsilon move from state src to state dst.
+*/
+void NFA_add_epsilon(NFA* nfa, int src, int dst) {
+	int n = (nfa->numStates);
+	if ((nfa->epsilon) == NULL) {
+		int nwords = IntSet_words_for(n);
+		(nfa->epsilon) = (IntSet*)malloc(2 * n * sizeof(IntSet));		//Epsilon sets, then closures
+		(nfa->closure) = (nfa->epsilon) + n;
+		(nfa->epsilonWords) = (uint64_t*)malloc((size_t)2 * n * nwords * sizeof(uint64_t));
+		for (int i = 0; i < 2 * n; i++) {
+			IntSet_init(&((nfa->epsilon)[i]), n, (nfa->epsilonWords) + (size_t)i * nwords);
+		}
+	}
+	if (!IntSet_contains(&((nfa->epsilon)[src]), dst)) {
+		IntSet_add(&((nfa->epsilon)[src]), dst);
+		(nfa->closed) = false;
+		NFA_drop_bits(nfa);
+	}
+}
+
+/**
+* Compute and cache the epsilon closure of every state of the given NFA.
+* Tarjan's algorithm finds the strongly connected components of the
+* epsilon moves in reverse topological order, so each component's closure
+* is its own states plus the closures of components already finished.
+*/
+void NFA_close(NFA* nfa) {
+	if ((nfa->closed)) {
+		return;
+	}
+	int n = (nfa->numStates);
+	int* index = (int*)malloc(n * sizeof(int));			//Visit order, or -1 if not yet visited
+	int* low = (int*)malloc(n * sizeof(int));
+	int* component = (int*)malloc(n * sizeof(int));		//Finished component of each state, or -1
+	int* stack = (int*)malloc(n * sizeof(int));			//States of unfinished components
+	int* calls = (int*)malloc(n * sizeof(int));			//Depth-first search path, in place of recursion
+	IntSetIterator* iters = (IntSetIterator*)malloc(n * sizeof(IntSetIterator));
+	for (int i = 0; i < n; i++) {
+		index[i] = -1;
+		component[i] = -1;
+	}
+	int visited = 0;
+	int ncomponents = 0;
+	int top = 0;
+
+	for (int root = 0; root < n; root++) {
+		if (index[root] != -1) {
+			continue;
+		}
+		int depth = 0;
+		index[root] = low[root] = visited++;
+		stack[top++] = root;
+		calls[depth] = root;
+		IntSetIterator_init(&(iters[depth++]), &((nfa->epsilon)[root]));
+		while (depth > 0) {
+			int v = calls[depth - 1];
+			if (IntSetIterator_has_next(&(iters[depth - 1]))) {
+				int w = IntSetIterator_next(&(iters[depth - 1]));
+				if (index[w] == -1) {							//Visit w next
+					index[w] = low[w] = visited++;
+					stack[top++] = w;
+					calls[depth] = w;
+					IntSetIterator_init(&(iters[depth++]), &((nfa->epsilon)[w]));
+				}
+				else if (component[w] == -1 && index[w] < low[v]) {	//w is still on the stack
+					low[v] = index[w];
+				}
+				continue;
+			}
+			depth--;
+			if (depth > 0 && low[v] < low[calls[depth - 1]]) {
+				low[calls[depth - 1]] = low[v];
+			}
+			if (low[v] != index[v]) {
+				continue;
+			}
+
+			//v is the root of a component: pop its states and close them together
+			int first = top;
+			do {
+				component[stack[--first]] = ncomponents;
+			} while (stack[first] != v);
+			IntSet* closure = &((nfa->closure)[v]);
+			IntSet_clear(closure);
+			for (int i = first; i < top; i++) {
+				int q = stack[i];
+				IntSet_add(closure, q);
+				IntSetIterator iter;
+				IntSetIterator_init(&iter, &((nfa->epsilon)[q]));
+				while (IntSetIterator_has_next(&iter)) {
+					int w = IntSetIterator_next(&iter);
+					if (component[w] != ncomponents) {			//Closures of later components are already done
+						IntSet_union(closure, &((nfa->closure)[w]));
+					}
+				}
+			}
+			for (int i = first; i < top; i++) {
+				if (stack[i] != v) {
+					IntSet_copy(&((nfa->closure)[stack[i]]), closure);
+				}
+			}
+			top = first;
+			ncomponents++;
+		}
+	}
+
+	free(index);
+	free(low);
+	free(component);
+	free(stack);
+	free(calls);
+	free(iters);
+	(nfa->closed) = true;
+}
+
+/**
+* Return true if the given NFA has any epsilon moves.
+*/
+bool NFA_has_epsilon(const NFA* nfa) {
+	return (nfa->epsilon) != NULL;
+}
+
+//Stop with a message if the given NFA has epsilon moves that NFA_close has not yet seen
+static void NFA_check_closed(const NFA* nfa, const char* caller) {
+	if (!(nfa->closed)) {
+		fprintf(stderr, "%s: NFA has epsilon moves but NFA_close was not called\n", caller);
+		abort();
+	}
+}
+
+/**
+* Add to the given set of states of the given NFA every state reachable
+* from them by epsilon moves, using the closures cached by NFA_close.
+*/
+void NFA_close_set(const NFA* nfa, IntSet* set) {
+	if ((nfa->epsilon) == NULL) {
+		return;
+	}
+	NFA_check_closed(nfa, "NFA_close_set");
+	for (int w = 0; w < (set->nwords); w++) {
+		uint64_t bits = (set->words)[w];					//States added below are already closed
+		while (bits != 0) {
+			IntSet_union(set, &((nfa->closure)[w * 64 + IntSet_ctz(bits)]));
+			bits &= bits - 1;
+		}
+	}
+}
+
+//Mix of one transition, so that summing them hashes a set of transitions
+static uint64_t NFA_edge_hash(int src, int dst) {
+	uint64_t x = ((uint64_t)(uint32_t)src << 32 | (uint32_t)dst) * 0x9e3779b97f4a7c15ULL;
+	x ^= x >> 29;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	return x ^ (x >> 32);
+}
+
+//An NFA, with the hash of the transitions on each symbol
+typedef struct {
+	const NFA* nfa;
+	uint64_t hash[sigma];
+}NFA_Columns;
+
+//Hash of the transitions on sym
+static uint64_t NFA_column_hash(const void* ctx, int sym) {
+	return ((const NFA_Columns*)ctx)->hash[sym];
+}
+
+//True if the given edges out of one state lead to dst on sym
+static bool NFA_edges_reach(const NFA_Edge* edges, int n, int sym, int dst) {
+	for (int i = 0; i < n && edges[i].lo <= sym; i++) {
+		if (edges[i].dst == dst && sym <= edges[i].hi) {
+			return true;
+		}
+	}
+	return false;
+}
+
+//True if sym1 and sym2 lead to the same sets of states from every state
+static bool NFA_same_column(const void* ctx, int sym1, int sym2) {
+	const NFA* nfa = ((const NFA_Columns*)ctx)->nfa;
+	for (int q = 0; q < (nfa->numStates); q++) {
+		const NFA_Edge* edges = (nfa->out)[q].edges;
+		int n = (nfa->out)[q].size;
+		for (int i = 0; i < n; i++) {
+			bool on1 = (edges[i].lo <= sym1 && sym1 <= edges[i].hi);
+			bool on2 = (edges[i].lo <= sym2 && sym2 <= edges[i].hi);
+			if (on1 != on2 && !NFA_edges_reach(edges, n, on1 ? sym2 : sym1, edges[i].dst)) {
+				return false;					//Another edge to the same state might cover the other symbol
+			}
+		}
+	}
+	return true;
+}
+
+/**
+* Compute the classes of input symbols that the given NFA does not tell
+* apart, storing each symbol's class in classes and returning the number of
+* classes. The NFA itself is not changed. Each edge adds its hash to the
+* symbols it covers, by a prefix sum over the ends of its range, so the
+* hashes take one pass over the edges.
+*/
+int NFA_get_classes(const NFA* nfa, uint8_t* classes) {
+	NFA_Columns columns;
+	uint64_t delta[sigma + 1] = { 0 };
+	for (int q = 0; q < (nfa->numStates); q++) {
+		const NFA_EdgeList* list = &((nfa->out)[q]);
+		for (int i = 0; i < (list->size); i++) {
+			const NFA_Edge* e = &((list->edges)[i]);
+			uint64_t h = NFA_edge_hash(q, e->dst);
+			delta[e->lo] += h;
+			delta[(e->hi) + 1] -= h;
+		}
+	}
+	columns.nfa = nfa;
+	uint64_t h = 0;
+	for (int sym = 0; sym < sigma; sym++) {
+		h += delta[sym];
+		columns.hash[sym] = h;
+	}
+	return ByteClass_partition(classes, NFA_column_hash, NFA_same_column, &columns);
+}
+
+/**
+* Pack the given NFA's edge lists end to end in state order, give each
+* state with more than NFA_DENSE_EDGES edges a dense row, and return the
+* number of classes of input symbols that it does not tell apart.
+*/
+int NFA_compress(NFA* nfa) {
+	Arena* arena = Arena_new(0);
+	NFA_Edge* packed = (NFA_Edge*)Arena_alloc(arena, ((size_t)(nfa->numEdges) + 1) * sizeof(NFA_Edge));
+	for (int q = 0; q < (nfa->numStates); q++) {
+		NFA_EdgeList* list = &((nfa->out)[q]);
+		if ((list->size) > 0) {
+			memcpy(packed, list->edges, (list->size) * sizeof(NFA_Edge));
+		}
+		(list->edges) = packed;
+		(list->capacity) = (list->size);
+		(list->row) = NULL;
+		packed += (list->size);
+	}
+	Arena_free(nfa->arena);
+	(nfa->arena) = arena;
+
+	int nclasses = NFA_get_classes(nfa, nfa->classes);
+	int nwords = IntSet_words_for(nfa->numStates);
+	(nfa->numClasses) = nclasses;
+	for (int q = 0; q < (nfa->numStates); q++) {
+		NFA_EdgeList* list = &((nfa->out)[q]);
+		if ((list->size) == 0 || ((list->size) <= NFA_DENSE_EDGES && (size_t)nclasses * nwords > NFA_DENSE_WORDS)) {
+			continue;							//Searching a few edges is cheaper than a large row
+		}
+		uint64_t* row = (uint64_t*)Arena_calloc(arena, (size_t)nclasses * nwords, sizeof(uint64_t));
+		for (int i = 0; i < (list->size); i++) {
+			const NFA_Edge* e = &((list->edges)[i]);
+			for (int c = (e->lo); c <= (e->hi); c++) {
+				uint64_t* words = row + (size_t)(nfa->classes)[c] * nwords;
+				words[(e->dst) >> 6] |= (uint64_t)1 << ((e->dst) & 63);
+			}
+		}
+		(list->row) = row;
+	}
+	NFA_drop_bits(nfa);
+	if ((nfa->closed)) {
+		(nfa->bits) = BitNFA_new(nfa);
+	}
+	return nclasses;
+}
+
+/**
+* Return a new NFA that accepts the reverse of every string the given NFA
+* accepts.
+*/
+NFA* NFA_reverse(const NFA* nfa) {
+	int n = (nfa->numStates);
+	NFA* rev = NFA_new(n + 1);
+	for (int q = 0; q < n; q++) {
+		const NFA_EdgeList* list = &((nfa->out)[q]);
+		for (int i = 0; i < (list->size); i++) {
+			const NFA_Edge* e = &((list->edges)[i]);
+			NFA_add_transition_range(rev, (e->dst) + 1, e->lo, e->hi, q + 1);
+		}
+		if ((nfa->epsilon) != NULL) {
+			IntSetIterator iter;
+			IntSetIterator_init(&iter, &((nfa->epsilon)[q]));
+			while (IntSetIterator_has_next(&iter)) {
+				NFA_add_epsilon(rev, IntSetIterator_next(&iter) + 1, q + 1);
+			}
+		}
+		if ((nfa->accept)[q]) {
+			NFA_add_epsilon(rev, 0, q + 1);					//Start wherever the given NFA could finish
+		}
+	}
+	if (n > 0) {
+		NFA_set_accepting(rev, 1, true);					//Finish where it started
 	}
+	NFA_close(rev);
+	NFA_compress(rev);
+	return rev;
 }
 
 /**
 * Set whether the given NFA's state is accepting or not.
 */
 void NFA_set_accepting(NFA* nfa, int state, bool value) {
+	NFA_drop_bits(nfa);
 	(nfa->accept)[state] = value;
 }
 
 /**
 * Return true if the given NFA's state is an accepting state.
 */
-bool NFA_get_accepting(NFA* nfa, int state) {
+bool NFA_get_accepting(const NFA* nfa, int state) {
 	return (nfa->accept)[state];
 }
 
 /**
-* Run the given NFA on the given input string, and return true if it accepts
-* the input, otherwise false.
+* Make the given NFA's state accepting, reporting the pattern id when the
+* input ends there.
 */
-bool NFA_execute(NFA* nfa, char *input) {
-	for (int i = 0; input[i] != '\0'; i++) {
-		IntSet* next = IntSet_new();
-		
-		IntSetIterator* iter = IntSet_iterator(nfa->curr);								//Iterate through current state.
-		while (IntSetIterator_has_next(iter)) {
-			IntSet_union(next, NFA_get_transitions(nfa, IntSetIterator_next(iter), input[i]) ); //Union transition from state in curr on char c to IntSet next
+void NFA_set_pattern(NFA* nfa, int state, int id) {
+	if ((nfa->pattern) == NULL) {
+		(nfa->pattern) = (int*)calloc(nfa->numStates, sizeof(int));
+	}
+	(nfa->pattern)[state] = id;
+	(nfa->accept)[state] = true;
+	NFA_drop_bits(nfa);
+}
+
+/**
+* Return the pattern id reported by the given NFA's state, which should be
+* accepting.
+*/
+int NFA_get_pattern(const NFA* nfa, int state) {
+	return ((nfa->pattern) == NULL) ? 0 : (nfa->pattern)[state];
+}
+
+/**
+* Allocate and return a new scan context for the given NFA, positioned at
+* the start of an input.
+*/
+NFA_Context* NFA_context_new(const NFA* nfa) {
+	NFA_check_closed(nfa, "NFA_context_new");
+	int nwords = IntSet_words_for(nfa->numStates);
+	if ((nfa->bits) != NULL && BitNFA_words(nfa->bits) > nwords) {
+		nwords = BitNFA_words(nfa->bits);				//The bit-parallel state may have more positions than the NFA has states
+	}
+	NFA_Context* ctx = (NFA_Context*)malloc(sizeof(NFA_Context) + 2 * nwords * sizeof(uint64_t));
+	(ctx->nfa) = nfa;
+	(ctx->nwords) = nwords;
+	(ctx->curr) = (uint64_t*)(ctx + 1);				//Both sets live in the same block as the context
+	(ctx->next) = (ctx->curr) + nwords;
+	NFA_context_reset(ctx);
+	return ctx;
+}
+
+/**
+* Free the given scan context (but not its NFA).
+*/
+void NFA_context_free(NFA_Context* ctx) {
+	free(ctx);
+}
+
+/**
+* Return the given scan context to the start of a new input.
+*/
+void NFA_context_reset(NFA_Context* ctx) {
+	const NFA* nfa = (ctx->nfa);
+	memset(ctx->curr, 0, (ctx->nwords) * sizeof(uint64_t));
+	(ctx->alive) = ((nfa->numStates) > 0);
+	(ctx->bits) = (nfa->bits);
+	if ((nfa->bits) != NULL) {
+		BitNFA_start(nfa->bits, ctx->curr);
+	}
+	else if (ctx->alive) {
+		(ctx->curr)[0] = 1;							//Start in {0}, or its closure
+		if ((nfa->closure) != NULL) {
+			memcpy(ctx->curr, (nfa->closure)[0].words, (ctx->nwords) * sizeof(uint64_t));
 		}
+	}
+}
 
-		if (IntSet_is_empty(next)) { //Reject if no available transitions
-			return false;
+/**
+* Set the current states of the given scan context to the given set of
+* states of its NFA, which should be closed under epsilon moves, as if the
+* input so far had led there. Scanning then continues state by state.
+*/
+void NFA_context_set(NFA_Context* ctx, const IntSet* states) {
+	int nwords = IntSet_words_for(ctx->nfa->numStates);
+	memset(ctx->curr, 0, (ctx->nwords) * sizeof(uint64_t));
+	memcpy(ctx->curr, states->words, nwords * sizeof(uint64_t));
+	(ctx->bits) = NULL;								//The set is of states, not positions
+	(ctx->alive) = !IntSet_is_empty(states);
+}
+
+/**
+* Advance the given scan context over the next len bytes of its input.
+* Returns false once the input can no longer be accepted, after which
+* further calls do nothing.
+*/
+bool NFA_feed(NFA_Context* ctx, const uint8_t* buf, size_t len) {
+	const NFA* nfa = (ctx->nfa);
+	if ((ctx->bits) != NULL) {						//All states advance together, a word at a time
+		(ctx->alive) = (ctx->alive) && BitNFA_feed(ctx->bits, ctx->curr, buf, len);
+		return (ctx->alive);
+	}
+	int nwords = IntSet_words_for(nfa->numStates);	//The sets may have room for more positions than there are states
+	uint64_t* curr = (ctx->curr);
+	uint64_t* next = (ctx->next);
+
+	const NFA_EdgeList* out = (nfa->out);
+	const uint8_t* classes = (nfa->classes);
+	const IntSet* closure = (nfa->closure);
+	bool alive = (ctx->alive);
+
+	for (size_t i = 0; i < len && alive; i++) {
+		int c = buf[i];
+		for (int k = 0; k < nwords; k++) {
+			next[k] = 0;
 		}
-		else {
-			(nfa->curr) = next;
+		uint64_t any = 0;
+		for (int w = 0; w < nwords; w++) {			//Visit only the active states, lowest set bit first
+			uint64_t bits = curr[w];
+			while (bits != 0) {
+				const NFA_EdgeList* list = &(out[w * 64 + IntSet_ctz(bits)]);
+				bits &= bits - 1;
+				if ((list->row) != NULL) {			//Dense row: the targets are one set
+					const uint64_t* dst = (list->row) + (size_t)classes[c] * nwords;
+					for (int k = 0; k < nwords; k++) {
+						next[k] |= dst[k];
+						any |= dst[k];
+					}
+					continue;
+				}
+				const NFA_Edge* edges = (list->edges);
+				for (int j = 0; j < (list->size); j++) {	//Only the edges that exist, without branching on the symbol
+					uint64_t hit = ((unsigned)(c - edges[j].lo) <= (unsigned)(edges[j].hi - edges[j].lo));
+					next[edges[j].dst >> 6] |= hit << (edges[j].dst & 63);
+					any |= hit;
+				}
+			}
+		}
+		if (closure != NULL) {
+			for (int w = 0; w < nwords; w++) {		//Follow epsilon moves from the states just reached
+				uint64_t bits = next[w];
+				while (bits != 0) {
+					const uint64_t* dst = closure[w * 64 + IntSet_ctz(bits)].words;
+					bits &= bits - 1;
+					for (int k = 0; k < nwords; k++) {
+						next[k] |= dst[k];
+					}
+				}
+			}
 		}
+		uint64_t* tmp = curr;						//The next set becomes current; no allocation
+		curr = next;
+		next = tmp;
+		alive = (any != 0);							//Reject if no available transitions
 	}
-	IntSetIterator* iter = IntSet_iterator(nfa->curr);
-	while (IntSetIterator_has_next(iter)) {
-		if (NFA_get_accepting(nfa, IntSetIterator_next(iter))) {
-			return true;
+	(ctx->alive) = alive;
+	(ctx->curr) = curr;
+	(ctx->next) = next;
+	return (ctx->alive);
+}
+
+/**
+* Return true if the input fed to the given scan context so far is
+* accepted by its NFA. The context is unchanged, so more input may follow.
+*/
+bool NFA_finish(NFA_Context* ctx) {
+	if (!(ctx->alive)) {
+		return false;
+	}
+	if ((ctx->bits) != NULL) {
+		return BitNFA_accepting(ctx->bits, ctx->curr);
+	}
+	for (int w = 0; w < IntSet_words_for(ctx->nfa->numStates); w++) {
+		uint64_t bits = (ctx->curr)[w];
+		while (bits != 0) {
+			if ((ctx->nfa->accept)[w * 64 + IntSet_ctz(bits)]) {
+				return true;
+			}
+			bits &= bits - 1;
 		}
 	}
 	return false;
 }
 
+/**
+* Run the given NFA on the given input string, and return true if it accepts
+* the input, otherwise false.
+*/
+bool NFA_execute(const NFA* nfa, const char *input) {
+	NFA_Context* ctx = NFA_context_new(nfa);		//The only allocation, however long the input
+	NFA_feed(ctx, (const uint8_t*)input, strlen(input));
+	bool accepted = NFA_finish(ctx);
+	NFA_context_free(ctx);
+	return accepted;
+}
+
 /**
 * Print the given NFA to System.out.
 */
-void NFA_print(NFA* nfa) {
+void NFA_print(const NFA* nfa) {
 	printf("The set of states: 0, ... %d.\n", NFA_get_size(nfa) - 1);
 	printf("The start state is 0.\n");
 	printf("The transition function is given by the following transition table.\n");
 
-	//Print tTable
+	//Print the edges
 	for (int i = 0; i < (nfa->numStates); i++) {
 		printf("State: %d\t| ", i);					//Print state, followed by all possible transitions from that state
-		for (int j = 1; j < sigma; j++) {
-			if (IntSet_is_empty(&((nfa->tTable)[i][j])) == false) {
-				printf("on \'%c\' to ", (char)j);
-				IntSet_print(&((nfa->tTable)[i][j]));	//Print transition set from state i on input char j
-				printf("\t | ");
+		const NFA_EdgeList* list = &((nfa->out)[i]);
+		for (int j = 0; j < (list->size); j++) {
+			const NFA_Edge* e = &((list->edges)[j]);
+			if ((e->lo) == (e->hi)) {
+				printf("on \'%c\' to %d\t | ", (char)(e->lo), (e->dst));
+			}
+			else {
+				printf("on \'%c\'-\'%c\' to %d\t | ", (char)(e->lo), (char)(e->hi), (e->dst));
 			}
 		}
+		if ((nfa->epsilon) != NULL && !IntSet_is_empty(&((nfa->epsilon)[i]))) {
+			printf("on epsilon to ");
+			IntSet_print(&((nfa->epsilon)[i]));
+			printf("\t | ");
+		}
 		printf("halt on remaining inputs.\n");
 	}
 
 	printf("The accepting states are {");
 	for (int i = 0; i < NFA_get_size(nfa); i++) {
-		if ((nfa->accept)[i]) {
+		if ((nfa->accept)[i] && (nfa->pattern) != NULL) {
+			printf("%d (pattern %d)  ", i, (nfa->pattern)[i]);
+		}
+		else if ((nfa->accept)[i]) {
 			printf("%d  ", i);
 		}
 	}
@@ -11,22 +11,80 @@
 #define _nfa_h
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
 #include "IntSet.h"
+#include "ByteClass.h"
+#include "Arena.h"
+
+/**
+* Transition on a range of input symbols: on any symbol from lo to hi, the
+* NFA may move to state dst.
+*/
+typedef struct {
+	int dst;
+	uint8_t lo;
+	uint8_t hi;
+}NFA_Edge;
+
+#define NFA_DENSE_EDGES 8	//States with more edges than this get a dense row when packed
+#define NFA_DENSE_WORDS 32	//As do all states whose row would take no more words than this
+
+/**
+* The transitions out of one state of an NFA. The edges are sorted by lo,
+* and the edges to any one state neither overlap nor touch, so each state
+* appears at most once among the targets on a symbol.
+*/
+typedef struct {
+	int size;			//Number of edges
+	int capacity;		//Room for edges before the list must move
+	NFA_Edge* edges;
+	uint64_t* row;		//Dense row, or NULL: the bits of the set of targets on each class of symbols
+}NFA_EdgeList;
 
 /**
 * The data structure used to represent a nondeterministic finite automaton.
+* Only the transitions that exist are stored, as lists of edges on ranges
+* of symbols; once packed by NFA_compress, the lists lie end to end in state
+* order, in compressed sparse row form, and states with many edges, or with
+* small rows, also get a dense row of sets of states by class of symbols,
+* as a full transition table would have.
 * @see FOCS Section 10.3
 * @see Comments for DFA in dfa.h
 */
 typedef struct{
 	int numStates;
-	IntSet* curr;
 	bool* accept;
-	IntSet** tTable;
+	NFA_EdgeList* out;	//Transitions out of each state
+	int numEdges;		//Total number of edges
+	int numClasses;		//Number of sets in each dense row
+	uint8_t classes[sigma];	//Set of a dense row used for each input symbol
+	Arena* arena;		//Holds the edge lists and dense rows
+	IntSet* epsilon;	//Epsilon moves from each state, or NULL if there are none
+	IntSet* closure;	//Epsilon closure of each state, valid while closed is true
+	uint64_t* epsilonWords;	//Storage for the bits of epsilon and closure
+	bool closed;		//False after an epsilon move is added, until NFA_close
+	int* pattern;		//Pattern reported by each accepting state, or NULL if all report pattern 0
+	struct BitNFA* bits;	//Bit-parallel form, made by NFA_compress for small NFAs, or NULL
 }NFA;
 
+/**
+* Scan state for running an NFA over an input that may arrive in pieces:
+* the set of current states, and a second set that the next one is built
+* in. The two are swapped after every byte, so scanning never allocates.
+*/
+typedef struct {
+	const NFA* nfa;
+	int nwords;			//Words in each set
+	uint64_t* curr;
+	uint64_t* next;
+	const struct BitNFA* bits;	//The NFA's bit-parallel form while the sets hold its positions, or NULL
+	bool alive;			//False once no transition was available
+}NFA_Context;
+
 /**
 * Allocate and return a new NFA containing the given number of states.
+* Sets of states are sized to nstates, which may be arbitrarily large.
 */
 extern NFA* NFA_new(int nstates);
 
@@ -38,13 +96,20 @@ extern void NFA_free(NFA* nfa);
 /**
 * Return the number of states in the given NFA.
 */
-extern int NFA_get_size(NFA* nfa);
+extern int NFA_get_size(const NFA* nfa);
+
+/**
+* Add to the given set the next states specified by the given NFA's
+* transition function from the given state on input symbol sym.
+*/
+extern void NFA_get_transitions(const NFA* nfa, int state, char sym, IntSet* set);
 
 /**
-* Return the set of next states specified by the given NFA's transition
-* function from the given state on input symbol sym.
+* Store in *edges the edges out of the given NFA's state, and return how
+* many there are. They stay valid until a transition is added or the NFA is
+* compressed.
 */
-extern IntSet* NFA_get_transitions(NFA* nfa, int state, char sym);
+extern int NFA_get_edges(const NFA* nfa, int state, const NFA_Edge** edges);
 
 /**
 * For the given NFA, add the state dst to the set of next states from
@@ -52,6 +117,12 @@ extern IntSet* NFA_get_transitions(NFA* nfa, int state, char sym);
 */
 extern void NFA_add_transition(NFA* nfa, int src, char sym, int dst);
 
+/**
+* For the given NFA, add the state dst to the set of next states from
+* state src on every input symbol from lo to hi.
+*/
+extern void NFA_add_transition_range(NFA* nfa, int src, int lo, int hi, int dst);
+
 /**
 * Add a transition for the given NFA for each symbol in the given str.
 */
@@ -62,6 +133,59 @@ extern void NFA_add_transition_str(NFA* nfa, int src, char *str, int dst);
 */
 extern void NFA_add_transition_all(NFA* nfa, int src, int dst);
 
+/**
+* For the given NFA, add an epsilon move from state src to state dst, which
+* the NFA may take without reading any input. NFA_close must be called
+* after the last epsilon move is added and before the NFA is run.
+*/
+extern void NFA_add_epsilon(NFA* nfa, int src, int dst);
+
+/**
+* Compute and cache the epsilon closure of every state of the given NFA:
+* the states it can reach by epsilon moves alone, itself included. Runs in
+* time linear in the number of epsilon moves (times the size of a set), and
+* does nothing if the closures are already up to date.
+*/
+extern void NFA_close(NFA* nfa);
+
+/**
+* Return true if the given NFA has any epsilon moves.
+*/
+extern bool NFA_has_epsilon(const NFA* nfa);
+
+/**
+* Add to the given set of states of the given NFA every state reachable
+* from them by epsilon moves, using the closures cached by NFA_close.
+*/
+extern void NFA_close_set(const NFA* nfa, IntSet* set);
+
+/**
+* Compute the classes of input symbols that the given NFA does not tell
+* apart, storing each symbol's class in classes and returning the number of
+* classes. The NFA itself is not changed.
+*/
+extern int NFA_get_classes(const NFA* nfa, uint8_t* classes);
+
+/**
+* Pack the given NFA's edge lists end to end in state order, give a dense
+* row to each state with more than NFA_DENSE_EDGES edges or whose row takes
+* at most NFA_DENSE_WORDS words, and return the number of classes of input
+* symbols that the NFA does not tell apart. If the NFA is closed and small enough,
+* also make its bit-parallel form (see BitNFA.h), which NFA_execute and
+* NFA_feed then run instead. Adding a
+* transition afterwards may move the state's list and drops its row, and
+* any change to the NFA drops its bit-parallel form.
+*/
+extern int NFA_compress(NFA* nfa);
+
+/**
+* Return a new NFA that accepts the reverse of every string the given NFA
+* accepts. Its state q+1 is state q of the given NFA with every transition
+* and epsilon move turned around, and its new start state 0 has epsilon
+* moves to the states that were accepting. It is already closed.
+*/
+extern NFA* NFA_reverse(const NFA* nfa);
+
 /**
 * Set whether the given NFA's state is accepting or not.
 */
@@ -70,17 +194,68 @@ extern void NFA_set_accepting(NFA* nfa, int state, bool value);
 /**
 * Return true if the given NFA's state is an accepting state.
 */
-extern bool NFA_get_accepting(NFA* nfa, int state);
+extern bool NFA_get_accepting(const NFA* nfa, int state);
+
+/**
+* Make the given NFA's state accepting, reporting the pattern id when the
+* input ends there. Accepting states given no pattern report pattern 0.
+* Automata for several patterns can be combined into one NFA this way,
+* and subsetConstruct gives each DFA state the ids of all its NFA states.
+*/
+extern void NFA_set_pattern(NFA* nfa, int state, int id);
+
+/**
+* Return the pattern id reported by the given NFA's state, which should be
+* accepting.
+*/
+extern int NFA_get_pattern(const NFA* nfa, int state);
 
 /**
 * Run the given NFA on the given input string, and return true if it accepts
-* the input, otherwise false.
+* the input, otherwise false. The NFA is not modified, so one NFA may be run
+* on many threads at once.
+*/
+extern bool NFA_execute(const NFA* nfa, const char *input);
+
+/**
+* Allocate and return a new scan context for the given NFA, positioned at
+* the start of an input. The NFA must be closed if it has epsilon moves.
+*/
+extern NFA_Context* NFA_context_new(const NFA* nfa);
+
+/**
+* Free the given scan context (but not its NFA).
+*/
+extern void NFA_context_free(NFA_Context* ctx);
+
+/**
+* Return the given scan context to the start of a new input.
+*/
+extern void NFA_context_reset(NFA_Context* ctx);
+
+/**
+* Set the current states of the given scan context to the given set of
+* states of its NFA, which should be closed under epsilon moves, as if the
+* input so far had led there. Scanning then continues state by state.
+*/
+extern void NFA_context_set(NFA_Context* ctx, const IntSet* states);
+
+/**
+* Advance the given scan context over the next len bytes of its input.
+* Returns false once the input can no longer be accepted, after which
+* further calls do nothing.
+*/
+extern bool NFA_feed(NFA_Context* ctx, const uint8_t* buf, size_t len);
+
+/**
+* Return true if the input fed to the given scan context so far is
+* accepted by its NFA. The context is unchanged, so more input may follow.
 */
-extern bool NFA_execute(NFA* nfa, char *input);
+extern bool NFA_finish(NFA_Context* ctx);
 
 /**
 * Print the given NFA to System.out.
 */
-extern void NFA_print(NFA* nfa);
+extern void NFA_print(const NFA* nfa);
 
 #endif
@@ -0,0 +1,259 @@
+/*
+* Author: Peter Hess
+* File: product.c
+*
+* Implements the product construction. A state of the product is a pair of
+* states, one from each DFA, or HALT for a DFA that has stopped. Pairs are
+* found breadth-first from the pair of start states, in an array that
+* doubles as the work queue, and a hash table indexes them by pair, so only
+* the reachable pairs are ever built. A pair that can no longer lead to
+* acceptance (say, one whose first state cannot reach an accepting state,
+* for an intersection) is never added, and the result is then minimized.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "dfa.h"
+#include "minimize.h"
+#include "PairMap.h"
+#include "product.h"
+
+#define HALT -1
+
+//Boolean combination computed by a product
+typedef enum { PRODUCT_INTERSECT, PRODUCT_UNION, PRODUCT_DIFFERENCE } ProductOp;
+
+//Growable array of pairs; entry i is state i of the product
+typedef struct {
+	int size;
+	int capacity;
+	int* a;				//State of the first DFA in each pair, or HALT
+	int* b;				//State of the second DFA in each pair, or HALT
+	int nclasses;
+	int* tTable;		//size by nclasses transitions, filled in as pairs are processed
+}PairList;
+
+static void PairList_init(PairList* list, int nclasses) {
+	(list->size) = 0;
+	(list->capacity) = 16;
+	(list->nclasses) = nclasses;
+	(list->a) = (int*)malloc((list->capacity) * sizeof(int));
+	(list->b) = (int*)malloc((list->capacity) * sizeof(int));
+	(list->tTable) = (int*)malloc((list->capacity) * nclasses * sizeof(int));
+}
+
+//Append the pair (p, q) with an empty row of transitions, and return its index
+static int PairList_add(PairList* list, int p, int q) {
+	if ((list->size) == (list->capacity)) {
+		(list->capacity) *= 2;
+		(list->a) = (int*)realloc(list->a, (list->capacity) * sizeof(int));
+		(list->b) = (int*)realloc(list->b, (list->capacity) * sizeof(int));
+		(list->tTable) = (int*)realloc(list->tTable, (list->capacity) * (list->nclasses) * sizeof(int));
+	}
+	int n = (list->size)++;
+	(list->a)[n] = p;
+	(list->b)[n] = q;
+	for (int c = 0; c < (list->nclasses); c++) {
+		(list->tTable)[n * (list->nclasses) + c] = HALT;
+	}
+	return n;
+}
+
+//Store in live whether each state of the given DFA can reach an accepting state
+static void productLive(const DFA* dfa, bool* live) {
+	int n = (dfa->numStates);
+	int k = (dfa->numClasses);
+	int* predStart = (int*)calloc(n + 1, sizeof(int));		//Predecessors of each state, in CSR form
+	for (int q = 0; q < n; q++) {
+		for (int c = 0; c < k; c++) {
+			int dst = DFA_get_class_transition(dfa, q, c);
+			if (dst != HALT) {
+				predStart[dst + 1]++;
+			}
+		}
+	}
+	for (int q = 0; q < n; q++) {
+		predStart[q + 1] += predStart[q];
+	}
+	int* pos = (int*)malloc((n + 1) * sizeof(int));
+	int* pred = (int*)malloc((predStart[n] + 1) * sizeof(int));
+	for (int q = 0; q <= n; q++) {
+		pos[q] = predStart[q];
+	}
+	for (int q = 0; q < n; q++) {
+		for (int c = 0; c < k; c++) {
+			int dst = DFA_get_class_transition(dfa, q, c);
+			if (dst != HALT) {
+				pred[pos[dst]++] = q;
+			}
+		}
+	}
+	int top = 0;
+	int* stack = pos;										//Each state is pushed at most once
+	for (int q = 0; q < n; q++) {
+		live[q] = DFA_get_accepting(dfa, q);
+		if (live[q]) {
+			stack[top++] = q;
+		}
+	}
+	while (top > 0) {
+		int q = stack[--top];
+		for (int i = predStart[q]; i < predStart[q + 1]; i++) {
+			if (!live[pred[i]]) {
+				live[pred[i]] = true;
+				stack[top++] = pred[i];
+			}
+		}
+	}
+	free(pred);
+	free(pos);
+	free(predStart);
+}
+
+//True if the pair (p, q) can still lead to acceptance under op
+static bool productUseful(ProductOp op, const bool* liveA, const bool* liveB, int p, int q) {
+	bool la = (p != HALT) && liveA[p];
+	bool lb = (q != HALT) && liveB[q];
+	switch (op) {
+	case PRODUCT_INTERSECT:
+		return la && lb;
+	case PRODUCT_UNION:
+		return la || lb;
+	default:
+		return la;
+	}
+}
+
+//True if the pair (p, q) accepts under op
+static bool productAccepting(ProductOp op, const DFA* a, const DFA* b, int p, int q) {
+	bool accA = (p != HALT) && DFA_get_accepting(a, p);
+	bool accB = (q != HALT) && DFA_get_accepting(b, q);
+	switch (op) {
+	case PRODUCT_INTERSECT:
+		return accA && accB;
+	case PRODUCT_UNION:
+		return accA || accB;
+	default:
+		return accA && !accB;
+	}
+}
+
+//Minimal DFA for the combination op of the languages of a and b
+static DFA* product(const DFA* a, const DFA* b, ProductOp op) {
+	//Classes of the product: one per pair of classes of a and b that some symbol falls in
+	uint8_t classes[sigma];
+	int repA[sigma];										//Class of a and of b for each class of the product
+	int repB[sigma];
+	int* classOf = (int*)malloc((size_t)(a->numClasses) * (b->numClasses) * sizeof(int));
+	for (int i = 0; i < (a->numClasses) * (b->numClasses); i++) {
+		classOf[i] = -1;
+	}
+	int nclasses = 0;
+	for (int sym = 0; sym < sigma; sym++) {
+		int ca = (a->classes)[sym];
+		int cb = (b->classes)[sym];
+		int* c = &(classOf[ca * (b->numClasses) + cb]);
+		if (*c == -1) {
+			repA[nclasses] = ca;
+			repB[nclasses] = cb;
+			*c = nclasses++;
+		}
+		classes[sym] = (uint8_t)*c;
+	}
+	free(classOf);
+
+	bool* liveA = (bool*)malloc((a->numStates) + 1);
+	bool* liveB = (bool*)malloc((b->numStates) + 1);
+	productLive(a, liveA);
+	productLive(b, liveB);
+
+	PairMap* index = PairMap_new();
+	PairList list;
+	PairList_init(&list, nclasses);
+	int startA = ((a->numStates) > 0) ? 0 : HALT;
+	int startB = ((b->numStates) > 0) ? 0 : HALT;
+	PairMap_put(index, startA, startB, PairList_add(&list, startA, startB));
+	for (int head = 0; head < (list.size); head++) {		//The list is the work queue
+		int p = (list.a)[head];
+		int q = (list.b)[head];
+		for (int c = 0; c < nclasses; c++) {
+			int np = (p == HALT) ? HALT : DFA_get_class_transition(a, p, repA[c]);
+			int nq = (q == HALT) ? HALT : DFA_get_class_transition(b, q, repB[c]);
+			if (!productUseful(op, liveA, liveB, np, nq)) {
+				continue;									//Left as HALT
+			}
+			int dst = PairMap_get(index, np, nq);
+			if (dst == -1) {
+				dst = PairList_add(&list, np, nq);
+				PairMap_put(index, np, nq, dst);
+			}
+			(list.tTable)[head * nclasses + c] = dst;
+		}
+	}
+
+	DFA* dfa = DFA_new_classes(list.size, classes, nclasses);
+	for (int i = 0; i < (list.size); i++) {
+		DFA_set_accepting(dfa, i, productAccepting(op, a, b, (list.a)[i], (list.b)[i]));
+		for (int c = 0; c < nclasses; c++) {
+			DFA_set_class_transition(dfa, i, c, (list.tTable)[i * nclasses + c]);
+		}
+	}
+	free(list.a);
+	free(list.b);
+	free(list.tTable);
+	PairMap_free(index);
+	free(liveA);
+	free(liveB);
+	DFA* min = DFA_minimize(dfa);
+	DFA_free(dfa);
+	return min;
+}
+
+/**
+* Return a new minimal DFA for the strings accepted by both of the given
+* DFAs, which are not changed.
+*/
+DFA* DFA_intersect(const DFA* a, const DFA* b) {
+	return product(a, b, PRODUCT_INTERSECT);
+}
+
+/**
+* Return a new minimal DFA for the strings accepted by either of the given
+* DFAs, which are not changed.
+*/
+DFA* DFA_union(const DFA* a, const DFA* b) {
+	return product(a, b, PRODUCT_UNION);
+}
+
+/**
+* Return a new minimal DFA for the strings accepted by a but not by b,
+* which are not changed.
+*/
+DFA* DFA_difference(const DFA* a, const DFA* b) {
+	return product(a, b, PRODUCT_DIFFERENCE);
+}
+
+/**
+* Return a new minimal DFA for the strings the given DFA rejects.
+*/
+DFA* DFA_complement(const DFA* dfa) {
+	int n = (dfa->numStates);
+	int k = (dfa->numClasses);
+	DFA* total = DFA_new_classes(n + 1, dfa->classes, k);	//State n is the dead state
+	for (int q = 0; q < n; q++) {
+		DFA_set_accepting(total, q, !DFA_get_accepting(dfa, q));
+		for (int c = 0; c < k; c++) {
+			int dst = DFA_get_class_transition(dfa, q, c);
+			DFA_set_class_transition(total, q, c, (dst == HALT) ? n : dst);
+		}
+	}
+	DFA_set_accepting(total, n, true);
+	for (int c = 0; c < k; c++) {
+		DFA_set_class_transition(total, n, c, n);
+	}
+	DFA* min = DFA_minimize(total);
+	DFA_free(total);
+	return min;
+}
@@ -0,0 +1,43 @@
+/*
+* Author: Peter Hess
+* File: product.h
+*
+* Boolean combinations of the languages of DFAs: intersection, union and
+* difference by the product construction, and complement.
+*/
+
+#ifndef _product_h
+#define _product_h
+
+#include "dfa.h"
+
+/**
+* Return a new minimal DFA for the strings accepted by both of the given
+* DFAs, which are not changed. Only the pairs of states reachable from the
+* pair of start states are built, and pairs from which no string can be
+* accepted become HALT as soon as they are found. Pattern ids reported by
+* the DFAs are not kept; every accepting state reports pattern 0.
+*/
+extern DFA* DFA_intersect(const DFA* a, const DFA* b);
+
+/**
+* Return a new minimal DFA for the strings accepted by either of the given
+* DFAs, which are not changed. As for DFA_intersect, pattern ids are not
+* kept.
+*/
+extern DFA* DFA_union(const DFA* a, const DFA* b);
+
+/**
+* Return a new minimal DFA for the strings accepted by a but not by b,
+* which are not changed. As for DFA_intersect, pattern ids are not kept.
+*/
+extern DFA* DFA_difference(const DFA* a, const DFA* b);
+
+/**
+* Return a new minimal DFA for the strings the given DFA rejects. The
+* missing (HALT) transitions of the DFA are sent to an explicit dead state,
+* which accepts in the complement.
+*/
+extern DFA* DFA_complement(const DFA* dfa);
+
+#endif
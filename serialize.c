@@ -0,0 +1,330 @@
+/*
+* Author: Peter Hess
+* File: serialize.c
+*
+* Saving compiled DFAs to files, and mapping them back into memory.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "dfa.h"
+#include "accel.h"
+#include "serialize.h"
+
+#define DFA_FILE_MAGIC "AUTODFA"		//With its NUL, the first 8 bytes of every file
+#define DFA_FILE_BYTE_ORDER 0x01020304	//Reads back differently on a machine of the other byte order
+#define DFA_FILE_ALIGN 64
+
+//First bytes of the file; every field has a fixed size, so the layout has no padding
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t numStates;
+	uint32_t width;
+	uint32_t numClasses;
+	uint32_t alphabet;			//sigma of the program that saved the file
+	uint32_t numAccel;			//Number of accelerated states, 0 if the DFA is not accelerated
+	uint32_t hasMatches;		//1 if the DFA has match lists
+	uint32_t numIds;			//Total length of the match lists
+	uint32_t reserved;			//0, keeping the offsets 8-byte aligned
+	uint64_t classes;			//Offset of each section from the start of the file
+	uint64_t accept;			//numStates bytes, 0 or 1
+	uint64_t table;				//numStates by numClasses state ids of width bytes
+	uint64_t matchStart;		//numStates + 1 uint32_t: the ids of state q are matchIds[matchStart[q]..matchStart[q+1])
+	uint64_t matchIds;			//int32_t pattern ids
+	uint64_t accelOf;			//numStates int32_t, as dfa->accelOf
+	uint64_t escapes;			//numAccel bitmaps of sigma bits, of the bytes that leave each accelerated state
+	uint64_t size;				//Size of the whole file
+}DFA_FileHeader;
+
+//Pattern ids and accelOf are used in place as int, so int must be 32 bits
+typedef char DFA_file_int_size_check[(sizeof(int) == sizeof(int32_t)) ? 1 : -1];
+
+//Round offset up to the next section boundary
+static uint64_t DFA_file_align(uint64_t offset) {
+	return (offset + DFA_FILE_ALIGN - 1) / DFA_FILE_ALIGN * DFA_FILE_ALIGN;
+}
+
+//Set the section offsets and size of the header from its counts; every file is laid out this way
+static void DFA_file_layout(DFA_FileHeader* header) {
+	uint64_t n = (header->numStates);
+	(header->classes) = DFA_file_align(sizeof(DFA_FileHeader));
+	(header->accept) = DFA_file_align((header->classes) + sigma);
+	(header->table) = DFA_file_align((header->accept) + n);
+	(header->matchStart) = DFA_file_align((header->table) + n * (header->numClasses) * (header->width));
+	(header->matchIds) = DFA_file_align((header->matchStart) + ((header->hasMatches) ? (n + 1) * sizeof(uint32_t) : 0));
+	(header->accelOf) = DFA_file_align((header->matchIds) + (uint64_t)(header->numIds) * sizeof(int32_t));
+	(header->escapes) = DFA_file_align((header->accelOf) + ((header->numAccel) > 0 ? n * sizeof(int32_t) : 0));
+	(header->size) = (header->escapes) + (uint64_t)(header->numAccel) * (sigma / 8);
+}
+
+//Write n bytes of data at offset, padding with zeros from *pos, the current end of the file
+static bool DFA_file_write(FILE* file, uint64_t* pos, uint64_t offset, const void* data, size_t n) {
+	static const char zeros[DFA_FILE_ALIGN] = { 0 };
+	while (*pos < offset) {
+		size_t pad = (offset - *pos < DFA_FILE_ALIGN) ? offset - *pos : DFA_FILE_ALIGN;
+		if (fwrite(zeros, 1, pad, file) != pad) {
+			return false;
+		}
+		*pos += pad;
+	}
+	if (n > 0 && fwrite(data, 1, n, file) != n) {
+		return false;
+	}
+	*pos = offset + n;
+	return true;
+}
+
+/**
+* Write the given DFA to the file at path, replacing it. Returns false if
+* the file could not be written.
+*/
+bool DFA_save(const DFA* dfa, const char* path) {
+	int n = (dfa->numStates);
+	size_t tableSize = (size_t)n * (dfa->numClasses) * (dfa->width);
+	uint32_t* matchStart = NULL;
+	int32_t* matchIds = NULL;
+	uint32_t numIds = 0;
+	if ((dfa->matches) != NULL) {
+		matchStart = (uint32_t*)malloc((n + 1) * sizeof(uint32_t));
+		for (int q = 0; q < n; q++) {
+			matchStart[q] = numIds;
+			numIds += (dfa->numMatches)[q];
+		}
+		matchStart[n] = numIds;
+		matchIds = (int32_t*)malloc((numIds + 1) * sizeof(int32_t));
+		for (int q = 0; q < n; q++) {
+			for (int i = 0; i < (dfa->numMatches)[q]; i++) {
+				matchIds[matchStart[q] + i] = (dfa->matches)[q][i];
+			}
+		}
+	}
+	uint32_t numAccel = 0;
+	int32_t* accelOf = NULL;
+	uint8_t* escapes = NULL;
+	if ((dfa->accelOf) != NULL) {
+		accelOf = (int32_t*)malloc((n + 1) * sizeof(int32_t));
+		for (int q = 0; q < n; q++) {
+			accelOf[q] = (dfa->accelOf)[q];
+			if (accelOf[q] >= (int32_t)numAccel) {
+				numAccel = accelOf[q] + 1;
+			}
+		}
+		escapes = (uint8_t*)calloc(numAccel + 1, sigma / 8);
+		for (uint32_t a = 0; a < numAccel; a++) {
+			for (int b = 0; b < sigma; b++) {
+				if (!((((dfa->accel)[a].stay)[b / 64] >> (b % 64)) & 1)) {
+					escapes[a * (sigma / 8) + b / 8] |= (uint8_t)(1 << (b % 8));
+				}
+			}
+		}
+	}
+
+	DFA_FileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, DFA_FILE_MAGIC, sizeof(header.magic));
+	header.version = DFA_FILE_VERSION;
+	header.byteOrder = DFA_FILE_BYTE_ORDER;
+	header.numStates = n;
+	header.width = (dfa->width);
+	header.numClasses = (dfa->numClasses);
+	header.alphabet = sigma;
+	header.numAccel = numAccel;
+	header.hasMatches = (matchStart != NULL);
+	header.numIds = numIds;
+	DFA_file_layout(&header);
+
+	uint8_t* accept = (uint8_t*)malloc(n + 1);
+	for (int q = 0; q < n; q++) {
+		accept[q] = (dfa->accept)[q] ? 1 : 0;
+	}
+
+	bool ok = false;
+	FILE* file = fopen(path, "wb");
+	if (file != NULL) {
+		uint64_t pos = 0;
+		ok = DFA_file_write(file, &pos, 0, &header, sizeof(header))
+			&& DFA_file_write(file, &pos, header.classes, dfa->classes, sigma)
+			&& DFA_file_write(file, &pos, header.accept, accept, n)
+			&& DFA_file_write(file, &pos, header.table, dfa->tTable, tableSize)
+			&& (matchStart == NULL || (DFA_file_write(file, &pos, header.matchStart, matchStart, (n + 1) * sizeof(uint32_t))
+				&& DFA_file_write(file, &pos, header.matchIds, matchIds, numIds * sizeof(int32_t))))
+			&& (accelOf == NULL || (DFA_file_write(file, &pos, header.accelOf, accelOf, n * sizeof(int32_t))
+				&& DFA_file_write(file, &pos, header.escapes, escapes, numAccel * (sigma / 8))))
+			&& DFA_file_write(file, &pos, header.size, NULL, 0);		//Pad out any empty sections at the end
+		ok = (fclose(file) == 0) && ok;
+	}
+	free(accept);
+	free(matchStart);
+	free(matchIds);
+	free(accelOf);
+	free(escapes);
+	return ok;
+}
+
+//True if the header describes a DFA this program can run from a file of the given size
+static bool DFA_file_valid(const DFA_FileHeader* header, uint64_t fileSize) {
+	if (memcmp(header->magic, DFA_FILE_MAGIC, sizeof(header->magic)) != 0 || (header->version) != DFA_FILE_VERSION
+		|| (header->byteOrder) != DFA_FILE_BYTE_ORDER || (header->alphabet) != sigma) {
+		return false;
+	}
+	uint32_t n = (header->numStates);
+	uint32_t width = (n < UINT8_MAX) ? 1 : (n < UINT16_MAX) ? 2 : 4;	//As chosen by DFA_new_classes
+	if (n > INT32_MAX || (header->width) != width || (header->numClasses) > sigma || (header->hasMatches) > 1
+		|| (!(header->hasMatches) && (header->numIds) != 0) || (header->numAccel) > n) {
+		return false;
+	}
+	DFA_FileHeader expected = *header;
+	DFA_file_layout(&expected);
+	return memcmp(&expected, header, sizeof(DFA_FileHeader)) == 0 && (header->size) <= fileSize;
+}
+
+//True if every entry of the table of a file with a valid header is a state or HALT (all ones).
+//This reads the table once, which costs far less than building it, but nothing is copied.
+static bool DFA_file_table_valid(const DFA_FileHeader* header, const char* base) {
+	uint32_t n = (header->numStates);
+	size_t size = (size_t)n * (header->numClasses);
+	const char* table = base + (header->table);
+	switch (header->width) {
+	case 1:
+		for (size_t i = 0; i < size; i++) {
+			uint8_t dst = ((const uint8_t*)table)[i];
+			if (dst >= n && dst != UINT8_MAX) {
+				return false;
+			}
+		}
+		break;
+	case 2:
+		for (size_t i = 0; i < size; i++) {
+			uint16_t dst = ((const uint16_t*)table)[i];
+			if (dst >= n && dst != UINT16_MAX) {
+				return false;
+			}
+		}
+		break;
+	default:
+		for (size_t i = 0; i < size; i++) {
+			int32_t dst = ((const int32_t*)table)[i];
+			if (dst < -1 || dst >= (int64_t)n) {
+				return false;
+			}
+		}
+		break;
+	}
+	return true;
+}
+
+//True if the small arrays of a file with a valid header index only what exists
+static bool DFA_file_indexes_valid(const DFA_FileHeader* header, const char* base) {
+	uint32_t n = (header->numStates);
+	for (int sym = 0; sym < sigma; sym++) {
+		if ((uint8_t)base[(header->classes) + sym] >= (header->numClasses)) {
+			return false;
+		}
+	}
+	for (uint32_t q = 0; q < n; q++) {
+		if ((uint8_t)base[(header->accept) + q] > 1) {
+			return false;
+		}
+	}
+	if (header->hasMatches) {
+		const uint32_t* matchStart = (const uint32_t*)(base + (header->matchStart));
+		for (uint32_t q = 0; q < n; q++) {
+			if (matchStart[q] > matchStart[q + 1]) {
+				return false;
+			}
+		}
+		if (matchStart[0] != 0 || matchStart[n] != (header->numIds)) {
+			return false;
+		}
+	}
+	if ((header->numAccel) > 0) {
+		const int32_t* accelOf = (const int32_t*)(base + (header->accelOf));
+		for (uint32_t q = 0; q < n; q++) {
+			if (accelOf[q] < -1 || accelOf[q] >= (int32_t)(header->numAccel)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+* Map the DFA file at path, written by DFA_save, read-only into memory and
+* return a DFA that runs from the mapping, or NULL if the file cannot be
+* read or is not a consistent DFA file of this version, byte order and
+* alphabet.
+*/
+DFA* DFA_map(const char* path) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(DFA_FileHeader)) {
+		close(fd);
+		return NULL;
+	}
+	void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);											//The mapping keeps the file open
+	if (mapping == MAP_FAILED) {
+		return NULL;
+	}
+	const DFA_FileHeader* header = (const DFA_FileHeader*)mapping;
+	char* base = (char*)mapping;
+	if (!DFA_file_valid(header, st.st_size)) {
+		munmap(mapping, st.st_size);
+		return NULL;
+	}
+
+	int n = (header->numStates);
+	if (!DFA_file_indexes_valid(header, base) || !DFA_file_table_valid(header, base)) {
+		munmap(mapping, st.st_size);
+		return NULL;
+	}
+	DFA* dfa = (DFA*)malloc(sizeof(DFA));
+	(dfa->numStates) = n;
+	(dfa->width) = (header->width);
+	(dfa->numClasses) = (header->numClasses);
+	memcpy(dfa->classes, base + (header->classes), sigma);
+	(dfa->accept) = (bool*)(base + (header->accept));
+	(dfa->tTable) = base + (header->table);
+	(dfa->numMatches) = NULL;
+	(dfa->matches) = NULL;
+	(dfa->arena) = NULL;
+	(dfa->accelOf) = NULL;
+	(dfa->accel) = NULL;
+	(dfa->mapping) = mapping;
+	(dfa->mappedSize) = st.st_size;
+
+	if (header->hasMatches) {							//Index the lists, which stay in the file
+		const uint32_t* matchStart = (const uint32_t*)(base + (header->matchStart));
+		(dfa->numMatches) = (int*)malloc((n + 1) * sizeof(int));
+		(dfa->matches) = (int**)malloc((n + 1) * sizeof(int*));
+		for (int q = 0; q < n; q++) {
+			(dfa->numMatches)[q] = matchStart[q + 1] - matchStart[q];
+			(dfa->matches)[q] = (int*)(base + (header->matchIds)) + matchStart[q];
+		}
+	}
+	if ((header->numAccel) > 0) {						//Rebuild the search kernels' masks from the escape bytes
+		const uint8_t* escapes = (const uint8_t*)(base + (header->escapes));
+		(dfa->accelOf) = (int*)(base + (header->accelOf));
+		(dfa->accel) = (Accel*)malloc((header->numAccel) * sizeof(Accel));
+		for (uint32_t a = 0; a < (header->numAccel); a++) {
+			bool leaves[sigma];
+			for (int b = 0; b < sigma; b++) {
+				leaves[b] = (escapes[a * (sigma / 8) + b / 8] >> (b % 8)) & 1;
+			}
+			Accel_init(&(dfa->accel)[a], leaves);
+		}
+	}
+	return dfa;
+}
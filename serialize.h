@@ -0,0 +1,45 @@
+/*
+* Author: Peter Hess
+* File: serialize.h
+*
+* Saving compiled DFAs to files, and mapping them back into memory.
+*
+* The file is the DFA's own arrays, laid out so that a DFA can run straight
+* from a read-only mapping of it with no pointers to fix up: a fixed header
+* of counts and section offsets, followed by the symbol class map, the
+* accepting flags, the transition table in the DFA's state id width, and,
+* if present, the match lists and the escape bytes of accelerated states.
+* Each section starts on a 64-byte boundary. Numbers are in the byte order
+* of the machine that saved the file; the header records it, and a machine
+* of the other order refuses the file. The header also records a format
+* version, which changes whenever the layout does.
+*/
+
+#ifndef _serialize_h
+#define _serialize_h
+
+#include <stdbool.h>
+#include "dfa.h"
+
+#define DFA_FILE_VERSION 2
+
+/**
+* Write the given DFA to the file at path, replacing it. Returns false if
+* the file could not be written.
+*/
+extern bool DFA_save(const DFA* dfa, const char* path);
+
+/**
+* Map the DFA file at path, written by DFA_save, read-only into memory and
+* return a DFA that runs from the mapping, or NULL if the file cannot be
+* read or is not a DFA file of this version, byte order and alphabet, or
+* is not consistent. The table is not copied, so loading a DFA costs far
+* less than building it, and processes that map the same file share one
+* copy of it in the page cache; it is read once, to check that every
+* transition leads to a state or halts, so a corrupt file is refused
+* rather than making the DFA read outside its table. The DFA must not be
+* changed, and DFA_free unmaps the file.
+*/
+extern DFA* DFA_map(const char* path);
+
+#endif
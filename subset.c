@@ -0,0 +1,384 @@
+/*
+* Author: Peter Hess
+* File: subset.c
+*
+* Implements the subset construction algorithm.
+* DFA states are kept in an array that doubles as the work queue, and a
+* SetMap indexes them by their set of NFA states, so each lookup is O(1)
+* rather than a scan over every state found so far. Successors are computed
+* once per class of input symbols rather than once per symbol, in one pass
+* over the edges out of the subset's states. subsetConstructParallel finds
+* the successors of many states at once on a ThreadPool, and numbers the
+* new states on one thread so that the DFA matches the serial one.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "dfa.h"
+#include "nfa.h"
+#include "IntSet.h"
+#include "SetMap.h"
+#include "Arena.h"
+#include "ByteClass.h"
+#include "minimize.h"
+#include "ThreadPool.h"
+#include "subset.h"
+
+#define HALT -1
+#define NEW -2
+#define SUBSET_CHUNK 16			//States of a round claimed by a worker at a time
+#define SUBSET_ROUND (1 << 16)	//Most states whose successors are found in one parallel round
+
+//DFA state: contains a set of states of the nfa and a boolean (whether the state is accepting or not)
+typedef struct {
+	IntSet* val;
+	bool toAccept;
+}dfaState;
+
+//Growable array of DFA states; entry i is DFA state i
+typedef struct {
+	int size;
+	int capacity;
+	dfaState* states;
+	int nclasses;
+	int* tTable;		//size by nclasses transitions, filled in as states are processed
+}dfaStateList;
+
+static void dfaStateList_init(dfaStateList* list, int nclasses) {
+	(list->size) = 0;
+	(list->capacity) = 16;
+	(list->nclasses) = nclasses;
+	(list->states) = (dfaState*)malloc((list->capacity) * sizeof(dfaState));
+	(list->tTable) = (int*)malloc((list->capacity) * nclasses * sizeof(int));
+}
+
+//Append a state with an empty row of transitions, and return its index
+static int dfaStateList_add(dfaStateList* list, IntSet* s, bool acc) {
+	if ((list->size) == (list->capacity)) {
+		(list->capacity) *= 2;
+		(list->states) = (dfaState*)realloc(list->states, (list->capacity) * sizeof(dfaState));
+		(list->tTable) = (int*)realloc(list->tTable, (list->capacity) * (list->nclasses) * sizeof(int));
+	}
+	int n = (list->size)++;
+	(list->states)[n].val = s;
+	(list->states)[n].toAccept = acc;
+	for (int c = 0; c < (list->nclasses); c++) {
+		(list->tTable)[n * (list->nclasses) + c] = HALT;
+	}
+	return n;
+}
+
+/**
+* Return true if the given set of states of the given NFA contains an
+* accepting state.
+*/
+bool subsetAccepting(const NFA* nfa, const IntSet* set) {
+	IntSetIterator iter;
+	IntSetIterator_init(&iter, set);
+	while (IntSetIterator_has_next(&iter)) {
+		if ((nfa->accept)[IntSetIterator_next(&iter)]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+//Order for sorting pattern ids
+static int compareInts(const void* a, const void* b) {
+	int x = *(const int*)a;
+	int y = *(const int*)b;
+	return (x > y) - (x < y);
+}
+
+/**
+* Store in ids the sorted, distinct pattern ids of the accepting states in
+* the given set of states of the given NFA, and return how many there are.
+*/
+int subsetPatterns(const NFA* nfa, const IntSet* set, int* ids) {
+	int n = 0;
+	IntSetIterator iter;
+	IntSetIterator_init(&iter, set);
+	while (IntSetIterator_has_next(&iter)) {
+		int state = IntSetIterator_next(&iter);
+		if ((nfa->accept)[state]) {
+			ids[n++] = NFA_get_pattern(nfa, state);
+		}
+	}
+	qsort(ids, n, sizeof(int), compareInts);
+	int distinct = 0;
+	for (int i = 0; i < n; i++) {
+		if (distinct == 0 || ids[i] != ids[distinct - 1]) {
+			ids[distinct++] = ids[i];
+		}
+	}
+	return distinct;
+}
+
+/**
+* Store in dst the set of states the given NFA can reach from any state in
+* the set src on input symbol sym.
+*/
+void subsetSuccessor(const NFA* nfa, const IntSet* src, int sym, IntSet* dst) {
+	IntSet_clear(dst);
+	IntSetIterator iter;
+	IntSetIterator_init(&iter, src);
+	while (IntSetIterator_has_next(&iter)) {
+		NFA_get_transitions(nfa, IntSetIterator_next(&iter), (char)sym, dst);
+	}
+	NFA_close_set(nfa, dst);
+}
+
+//Store in runEnd the last symbol of the run of symbols in the same class as each one
+static void subsetRuns(const uint8_t* classes, int* runEnd) {
+	for (int sym = sigma - 1; sym >= 0; sym--) {
+		runEnd[sym] = (sym + 1 < sigma && classes[sym + 1] == classes[sym]) ? runEnd[sym + 1] : sym;
+	}
+}
+
+//Store in dst[c] the successor of the set src on each class c, in one pass over the edges that exist
+static void subsetSuccessors(const NFA* nfa, const uint8_t* classes, const int* runEnd, int nclasses,
+	const IntSet* src, IntSet** dst) {
+	for (int c = 0; c < nclasses; c++) {
+		IntSet_clear(dst[c]);
+	}
+	IntSetIterator iter;
+	IntSetIterator_init(&iter, src);
+	while (IntSetIterator_has_next(&iter)) {
+		const NFA_Edge* edges;
+		int n = NFA_get_edges(nfa, IntSetIterator_next(&iter), &edges);
+		for (int i = 0; i < n; i++) {
+			for (int sym = edges[i].lo; sym <= edges[i].hi; sym = runEnd[sym] + 1) {
+				IntSet_add(dst[classes[sym]], edges[i].dst);
+			}
+		}
+	}
+	for (int c = 0; c < nclasses; c++) {
+		NFA_close_set(nfa, dst[c]);
+	}
+}
+
+//Add the closure of {0} as DFA state 0
+static void subsetStart(const NFA* nfa, dfaStateList* list, SetMap* index, Arena* arena) {
+	IntSet* start = IntSet_new_in(arena, nfa->numStates);
+	IntSet_add(start, 0);
+	NFA_close_set(nfa, start);
+	SetMap_put(index, start, dfaStateList_add(list, start, subsetAccepting(nfa, start)));
+}
+
+//Make the DFA for the states and transitions in list, and free the list
+static DFA* subsetBuild(const NFA* nfa, dfaStateList* list, const uint8_t* classes, int nclasses, Arena* arena) {
+	DFA* dfa = DFA_new_classes(list->size, classes, nclasses);	//create dfa with one state per subset found
+	int* ids = ((nfa->pattern) != NULL) ? (int*)Arena_alloc(arena, (nfa->numStates) * sizeof(int)) : NULL;
+	for (int i = 0; i < (list->size); i++) {
+		DFA_set_accepting(dfa, i, (list->states)[i].toAccept);
+		if (ids != NULL) {										//Each DFA state reports the patterns of all its NFA states
+			DFA_set_matches(dfa, i, ids, subsetPatterns(nfa, (list->states)[i].val, ids));
+		}
+		for (int c = 0; c < nclasses; c++) {
+			DFA_set_class_transition(dfa, i, c, (list->tTable)[i * nclasses + c]);
+		}
+	}
+	free(list->states);
+	free(list->tTable);
+	DFA_compress(dfa);						//Some classes may be told apart only by unreachable nfa states
+	DFA_accelerate(dfa, DFA_ACCEL_ESCAPES);
+	return dfa;
+}
+
+/*
+* Function which takes an NFA as input and outputs an equivalent DFA, that is a DFA that accepts the same language.
+* Uses the subset construction algorithm.
+*/
+DFA* subsetConstruct(const NFA* nfa) {
+	uint8_t classes[sigma];
+	int nclasses = NFA_get_classes(nfa, classes);	//Symbols in a class always lead to the same subset
+	int runEnd[sigma];
+	subsetRuns(classes, runEnd);
+
+	dfaStateList list;
+	dfaStateList_init(&list, nclasses);
+	SetMap* index = SetMap_new();			//Maps each set of nfa states to its state in the dfa
+	Arena* arena = Arena_new(0);			//Holds every set of nfa states made by this construction
+	subsetStart(nfa, &list, index, arena);
+
+	IntSet** dst = (IntSet**)Arena_alloc(arena, nclasses * sizeof(IntSet*));	//Destination state on each class
+	for (int c = 0; c < nclasses; c++) {
+		dst[c] = IntSet_new_in(arena, nfa->numStates);
+	}
+
+	for (int currIndex = 0; currIndex < list.size; currIndex++) {	//States after currIndex are the work queue
+		subsetSuccessors(nfa, classes, runEnd, nclasses, list.states[currIndex].val, dst);	//Union together all possible states on each class
+
+		for (int c = 0; c < nclasses; c++) {
+			if (IntSet_is_empty(dst[c])) {		//No available transitions on this class
+				continue;
+			}
+
+			int transDest = SetMap_get(index, dst[c]);
+			if (transDest == HALT) {			//dst is a new state, so add it to the work queue
+				IntSet* s = IntSet_new_in(arena, nfa->numStates);
+				IntSet_copy(s, dst[c]);
+				transDest = dfaStateList_add(&list, s, subsetAccepting(nfa, s));
+				SetMap_put(index, s, transDest);
+			}
+			list.tTable[currIndex * nclasses + c] = transDest;
+		}
+	}
+
+	DFA* dfa = subsetBuild(nfa, &list, classes, nclasses, arena);
+	Arena_free(arena);
+	SetMap_free(index);
+	return dfa;
+}
+
+//Successor of one state of the frontier on one class, as found by a worker
+typedef struct {
+	int dst;			//DFA state, HALT, or NEW if the set was not in the index when looked up
+	bool accept;		//For NEW: whether the set contains an accepting state
+	uint64_t hash;		//For NEW: the set's hash, and the set itself, in the worker's arena
+	IntSet* set;
+}subsetResult;
+
+//One round of the parallel construction: the successors of DFA states first to last-1
+typedef struct {
+	const NFA* nfa;
+	const uint8_t* classes;
+	const int* runEnd;
+	int nclasses;
+	const dfaStateList* list;
+	SetMap* index;			//Only read by the workers
+	int first;
+	int last;
+	atomic_int next;		//Next unclaimed state of the frontier
+	subsetResult* results;	//nclasses results per frontier state
+	Arena** arenas;			//Each worker's own sets, and its scratch sets in dst
+	IntSet*** dst;
+}subsetJob;
+
+static void subsetTask(void* arg, int worker) {
+	subsetJob* job = (subsetJob*)arg;
+	const NFA* nfa = (job->nfa);
+	int nclasses = (job->nclasses);
+	Arena* arena = (job->arenas)[worker];
+	if ((job->dst)[worker] == NULL) {
+		(job->dst)[worker] = (IntSet**)Arena_alloc(arena, nclasses * sizeof(IntSet*));
+		for (int c = 0; c < nclasses; c++) {
+			(job->dst)[worker][c] = IntSet_new_in(arena, nfa->numStates);
+		}
+	}
+	IntSet** dst = (job->dst)[worker];
+
+	while (true) {
+		int first = atomic_fetch_add(&(job->next), SUBSET_CHUNK);
+		if (first >= (job->last)) {
+			break;
+		}
+		int last = (first + SUBSET_CHUNK < (job->last)) ? first + SUBSET_CHUNK : (job->last);
+		for (int i = first; i < last; i++) {
+			subsetSuccessors(nfa, job->classes, job->runEnd, nclasses, (job->list->states)[i].val, dst);
+			subsetResult* r = (job->results) + (size_t)(i - (job->first)) * nclasses;
+			for (int c = 0; c < nclasses; c++) {
+				if (IntSet_is_empty(dst[c])) {
+					r[c].dst = HALT;
+					continue;
+				}
+				r[c].hash = IntSet_hash(dst[c]);
+				r[c].dst = SetMap_get_hashed(job->index, dst[c], r[c].hash);
+				if (r[c].dst == HALT) {					//Keep a copy; the numbering pass decides if it is new
+					r[c].dst = NEW;
+					r[c].set = IntSet_new_in(arena, nfa->numStates);
+					IntSet_copy(r[c].set, dst[c]);
+					r[c].accept = subsetAccepting(nfa, r[c].set);
+				}
+			}
+		}
+	}
+}
+
+/*
+* Subset construction with the successors of each round of states computed
+* on the workers of pool. The states still to be processed form the next
+* round, up to SUBSET_ROUND of them. While the workers run, the index is
+* only read, so they share it without locks; sets it does not hold are
+* copied and numbered afterwards, on one thread, in the order of states and
+* classes in which subsetConstruct would have found them. The DFA is
+* therefore the same, state for state, whatever the number of workers.
+*/
+DFA* subsetConstructParallel(const NFA* nfa, ThreadPool* pool) {
+	uint8_t classes[sigma];
+	int nclasses = NFA_get_classes(nfa, classes);
+	int runEnd[sigma];
+	subsetRuns(classes, runEnd);
+
+	dfaStateList list;
+	dfaStateList_init(&list, nclasses);
+	SetMap* index = SetMap_new();
+	Arena* arena = Arena_new(0);
+	subsetStart(nfa, &list, index, arena);
+
+	int nworkers = ThreadPool_size(pool);
+	subsetJob job;
+	job.nfa = nfa;
+	job.classes = classes;
+	job.runEnd = runEnd;
+	job.nclasses = nclasses;
+	job.list = &list;
+	job.index = index;
+	job.arenas = (Arena**)Arena_alloc(arena, nworkers * sizeof(Arena*));
+	job.dst = (IntSet***)Arena_calloc(arena, nworkers, sizeof(IntSet**));
+	for (int w = 0; w < nworkers; w++) {
+		job.arenas[w] = Arena_new(0);
+	}
+	size_t capacity = 0;
+	job.results = NULL;
+
+	for (int first = 0; first < list.size;) {
+		int last = (list.size - first > SUBSET_ROUND) ? first + SUBSET_ROUND : list.size;
+		size_t needed = (size_t)(last - first) * nclasses;
+		if (needed > capacity) {
+			capacity = needed;
+			job.results = (subsetResult*)realloc(job.results, capacity * sizeof(subsetResult));
+		}
+		job.first = first;
+		job.last = last;
+		atomic_init(&(job.next), first);
+		ThreadPool_run(pool, subsetTask, &job);
+
+		for (int i = first; i < last; i++) {			//Number the new states as subsetConstruct would
+			const subsetResult* r = job.results + (size_t)(i - first) * nclasses;
+			for (int c = 0; c < nclasses; c++) {
+				int transDest = r[c].dst;
+				if (transDest == NEW) {
+					transDest = SetMap_get_hashed(index, r[c].set, r[c].hash);	//Perhaps found earlier in this round
+					if (transDest == HALT) {
+						transDest = dfaStateList_add(&list, r[c].set, r[c].accept);
+						SetMap_put_hashed(index, r[c].set, r[c].hash, transDest);
+					}
+				}
+				list.tTable[i * nclasses + c] = transDest;
+			}
+		}
+		first = last;
+	}
+
+	DFA* dfa = subsetBuild(nfa, &list, classes, nclasses, arena);
+	free(job.results);
+	for (int w = 0; w < nworkers; w++) {
+		Arena_free(job.arenas[w]);
+	}
+	Arena_free(arena);
+	SetMap_free(index);
+	return dfa;
+}
+
+/*
+* Subset construction followed by minimization of the resulting DFA.
+*/
+DFA* subsetConstructMinimal(const NFA* nfa) {
+	DFA* dfa = subsetConstruct(nfa);
+	DFA* min = DFA_minimize(dfa);
+	DFA_free(dfa);
+	return min;
+}
@@ -0,0 +1,61 @@
+/*
+* Author: Peter Hess
+* File: subset.h
+*
+* Subset construction: conversion of an NFA to an equivalent DFA.
+*/
+
+#ifndef _subset_h
+#define _subset_h
+
+#include "dfa.h"
+#include "nfa.h"
+#include "IntSet.h"
+#include "ThreadPool.h"
+
+/**
+* Return a new DFA that accepts the same language as the given NFA.
+* Uses the subset construction algorithm; only subsets reachable from
+* the start state {0} become DFA states, numbered in the order they are
+* discovered. Every subset is closed under the NFA's epsilon moves, so the
+* NFA must have been closed by NFA_close. If the NFA's accepting states
+* have pattern ids, each DFA state reports the ids of all of its NFA states.
+*/
+extern DFA* subsetConstruct(const NFA* nfa);
+
+/**
+* Return the same DFA as subsetConstruct(nfa), state for state, with the
+* successors of the states found on the workers of pool. New states are
+* numbered in the order subsetConstruct finds them, so the result does not
+* depend on the number of workers or on how they are scheduled.
+*/
+extern DFA* subsetConstructParallel(const NFA* nfa, ThreadPool* pool);
+
+/**
+* Return a new DFA that accepts the same language as the given NFA and has
+* as few states as possible: the result of subsetConstruct, minimized by
+* DFA_minimize.
+*/
+extern DFA* subsetConstructMinimal(const NFA* nfa);
+
+/**
+* Return true if the given set of states of the given NFA contains an
+* accepting state.
+*/
+extern bool subsetAccepting(const NFA* nfa, const IntSet* set);
+
+/**
+* Store in ids the sorted, distinct pattern ids of the accepting states in
+* the given set of states of the given NFA, and return how many there are.
+* ids must have room for one id per state of the NFA.
+*/
+extern int subsetPatterns(const NFA* nfa, const IntSet* set, int* ids);
+
+/**
+* Store in dst the set of states the given NFA can reach from any state in
+* the set src on input symbol sym, followed by any epsilon moves. This is one transition of the DFA that
+* the subset construction builds.
+*/
+extern void subsetSuccessor(const NFA* nfa, const IntSet* src, int sym, IntSet* dst);
+
+#endif